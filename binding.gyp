@@ -14,9 +14,19 @@
         "src/native/export.cc",
         "src/native/impdet.cc",
         "src/native/waveform.cc",
+        "src/native/spectrum.cc",
+        "src/native/tempo.cc",
+        "src/native/analysis.cc",
         "src/native/recording.cc",
         "src/native/stretcher.cc",
-        "src/native/ringbuffer.cc"
+        "src/native/ringbuffer.cc",
+        "src/native/pool.cc",
+        "src/native/samples.cc",
+        "src/native/cache.cc",
+        "src/native/timing.cc",
+        "src/native/events.cc",
+        "src/native/automation.cc",
+        "src/native/prestretch.cc"
       ],
       'defines': [ 'NAPI_DISABLE_CPP_EXCEPTIONS' ],
       "conditions": [
@@ -0,0 +1,244 @@
+#include "analysis.h"
+
+PyramidAnalyzer::PyramidAnalyzer(){
+  pyramid = pyramid_new(0);
+  bins = 0;
+}
+
+void PyramidAnalyzer::process(float** channels, int count){
+  int base = pyramid->base;
+  float* samples = channels[0];
+
+  /* complete a bin left over from the last block */
+  if(pending.size()){
+    int take = std::min(count, base - (int)pending.size());
+    pending.insert(pending.end(), samples, samples + take);
+    samples += take;
+    count -= take;
+    if((int)pending.size() < base) return;
+    pyramid_resize(pyramid, bins + 1);
+    pyramid_fill(pyramid, pending.data(), bins, bins + 1);
+    bins++;
+    pending.clear();
+  }
+
+  int whole = count / base;
+  if(whole){
+    pyramid_resize(pyramid, bins + whole);
+    pyramid_fill(pyramid, samples, bins, bins + whole);
+    bins += whole;
+  }
+  pending.assign(samples + whole * base, samples + count);
+}
+
+void PyramidAnalyzer::finish(sourceAnalysis* analysis, int length){
+  if(pending.size() || !bins){
+    pending.resize(pyramid->base, 0);
+    pyramid_resize(pyramid, bins + 1);
+    pyramid_fill(pyramid, pending.data(), bins, bins + 1);
+    bins++;
+  }
+  pyramid_reduce(pyramid, 0, bins);
+  analysis->pyramid = pyramid;
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(){
+  builder = spectrum_builder_new();
+}
+
+void SpectrumAnalyzer::process(float** channels, int count){
+  spectrum_builder_push(builder, channels[0], count);
+}
+
+void SpectrumAnalyzer::finish(sourceAnalysis* analysis, int length){
+  analysis->spectrum = spectrum_builder_finish(builder, length);
+}
+
+OnsetAnalyzer::OnsetAnalyzer(){
+  filter = impulse_filter();
+  window = new float[IMPDET_WINSIZE];
+  windowUsed = 0;
+}
+
+OnsetAnalyzer::~OnsetAnalyzer(){
+  delete filter;
+  delete [] window;
+}
+
+void OnsetAnalyzer::process(float** channels, int count){
+  float* samples = channels[0];
+  while(count > 0){
+    int take = std::min(count, (int)IMPDET_WINSIZE - windowUsed);
+    std::copy(samples, samples + take, window + windowUsed);
+    samples += take;
+    count -= take;
+    windowUsed += take;
+    if(windowUsed == (int)IMPDET_WINSIZE){
+      filter->process(IMPDET_WINSIZE, &window);
+      energies.push_back(samples_energy(window, IMPDET_WINSIZE) / IMPDET_WINSIZE);
+      windowUsed = 0;
+    }
+  }
+}
+
+void OnsetAnalyzer::finish(sourceAnalysis* analysis, int length){
+  analysis->onsets.swap(energies);
+}
+
+/* k-weighting from ITU-R BS.1770, designed for the actual sample rate */
+LoudnessAnalyzer::LoudnessAnalyzer(){
+  double f0 = 1681.974450955533;
+  double gain = 3.999843853973347;
+  double q = 0.7071752369554196;
+  double k = tan(M_PI * f0 / SAMPLE_RATE);
+  double vh = pow(10., gain / 20.);
+  double vb = pow(vh, 0.4996667741545416);
+  double a0 = 1. + k / q + k * k;
+  shelf[0] = (vh + vb * k / q + k * k) / a0;
+  shelf[1] = 2. * (k * k - vh) / a0;
+  shelf[2] = (vh - vb * k / q + k * k) / a0;
+  shelf[3] = 2. * (k * k - 1.) / a0;
+  shelf[4] = (1. - k / q + k * k) / a0;
+
+  f0 = 38.13547087602444;
+  q = 0.5003270373238773;
+  k = tan(M_PI * f0 / SAMPLE_RATE);
+  a0 = 1. + k / q + k * k;
+  highpass[0] = 1.;
+  highpass[1] = -2.;
+  highpass[2] = 1.;
+  highpass[3] = 2. * (k * k - 1.) / a0;
+  highpass[4] = (1. - k / q + k * k) / a0;
+
+  for(int channel=0;channel<CHANNEL_COUNT;channel++)
+    for(int i=0;i<4;i++) state[channel][i] = 0;
+  stepEnergy = 0;
+  stepUsed = 0;
+  peak = 0;
+}
+
+void LoudnessAnalyzer::process(float** channels, int count){
+  for(int i=0;i<count;i++){
+    for(int channel=0;channel<CHANNEL_COUNT;channel++){
+      double* z = state[channel];
+      double x = channels[channel][i];
+      peak = std::max(peak, (float)fabs(x));
+
+      double w = x - shelf[3] * z[0] - shelf[4] * z[1];
+      double y = shelf[0] * w + shelf[1] * z[0] + shelf[2] * z[1];
+      z[1] = z[0];
+      z[0] = w;
+
+      w = y - highpass[3] * z[2] - highpass[4] * z[3];
+      y = highpass[0] * w + highpass[1] * z[2] + highpass[2] * z[3];
+      z[3] = z[2];
+      z[2] = w;
+
+      stepEnergy += y * y;
+    }
+    if(++stepUsed == LOUDNESS_STEP){
+      steps.push_back(stepEnergy);
+      stepEnergy = 0;
+      stepUsed = 0;
+    }
+  }
+}
+
+void LoudnessAnalyzer::finish(sourceAnalysis* analysis, int length){
+  /* gating blocks are four overlapping steps */
+  int stepsPerBlock = LOUDNESS_BLOCK / LOUDNESS_STEP;
+  std::vector<double> blocks;
+  double blockEnergy = 0;
+  for(unsigned int i=0;i<steps.size();i++){
+    blockEnergy += steps[i];
+    if((int)i >= stepsPerBlock) blockEnergy -= steps[i - stepsPerBlock];
+    if((int)i >= stepsPerBlock - 1) blocks.push_back(std::max(blockEnergy, 0.) / LOUDNESS_BLOCK);
+  }
+
+  double absoluteGate = pow(10., (LOUDNESS_ABSOLUTE_GATE + 0.691) / 10.);
+  double sum = 0;
+  int count = 0;
+  for(unsigned int i=0;i<blocks.size();i++)
+    if(blocks[i] > absoluteGate){ sum += blocks[i]; count++; }
+
+  analysis->loudness = LOUDNESS_ABSOLUTE_GATE;
+  if(count){
+    double relativeGate = (sum / count) * pow(10., LOUDNESS_RELATIVE_GATE / 10.);
+    sum = 0;
+    count = 0;
+    for(unsigned int i=0;i<blocks.size();i++)
+      if(blocks[i] > absoluteGate && blocks[i] > relativeGate){ sum += blocks[i]; count++; }
+    if(count) analysis->loudness = -0.691 + 10 * log10(sum / count);
+  }
+  analysis->peak = peak;
+}
+
+HashAnalyzer::HashAnalyzer(){
+  for(int channel=0;channel<CHANNEL_COUNT;channel++)
+    for(int lane=0;lane<HASH_LANES;lane++) lanes[channel][lane] = 14695981039346656037ULL + channel * HASH_LANES + lane;
+  position = 0;
+}
+
+void HashAnalyzer::process(float** channels, int count){
+  for(int channel=0;channel<CHANNEL_COUNT;channel++){
+    uint64_t* lane = lanes[channel];
+    for(int i=0;i<count;i++){
+      uint32_t bits;
+      memcpy(&bits, &channels[channel][i], sizeof(float));
+      uint64_t& h = lane[(position + i) % HASH_LANES];
+      h = (h ^ bits) * 1099511628211ULL;
+    }
+  }
+  position += count;
+}
+
+void HashAnalyzer::finish(sourceAnalysis* analysis, int length){
+  uint64_t hash = 14695981039346656037ULL ^ (uint64_t)length;
+  for(int channel=0;channel<CHANNEL_COUNT;channel++)
+    for(int lane=0;lane<HASH_LANES;lane++){
+      hash ^= lanes[channel][lane] + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+  analysis->hash = hash;
+}
+
+std::vector<Analyzer*> analyzers_new(){
+  std::vector<Analyzer*> analyzers;
+  analyzers.push_back(new PyramidAnalyzer());
+  analyzers.push_back(new SpectrumAnalyzer());
+  analyzers.push_back(new OnsetAnalyzer());
+  analyzers.push_back(new LoudnessAnalyzer());
+  analyzers.push_back(new HashAnalyzer());
+  return analyzers;
+}
+
+sourceAnalysis* analyzers_finish(std::vector<Analyzer*>& analyzers, int length){
+  sourceAnalysis* analysis = new sourceAnalysis{};
+  for(unsigned int i=0;i<analyzers.size();i++){
+    analyzers[i]->finish(analysis, length);
+    delete analyzers[i];
+  }
+  analyzers.clear();
+  return analysis;
+}
+
+sourceAnalysis* analysis_run(std::vector<void*>& channels, int format, int length){
+  std::vector<Analyzer*> analyzers = analyzers_new();
+  std::vector<float*> block;
+  for(unsigned int c=0;c<channels.size();c++) block.push_back(new float[ANALYSIS_BLOCK]);
+
+  for(int start=0;start<length;start+=ANALYSIS_BLOCK){
+    int count = std::min(ANALYSIS_BLOCK, length - start);
+    for(unsigned int c=0;c<channels.size();c++)
+      samples_read(channels[c], format, length, start, count, block[c]);
+    for(unsigned int i=0;i<analyzers.size();i++) analyzers[i]->process(block.data(), count);
+  }
+
+  for(unsigned int c=0;c<block.size();c++) delete [] block[c];
+  return analyzers_finish(analyzers, length);
+}
+
+void analysis_delete(sourceAnalysis* analysis){
+  if(analysis->pyramid != NULL) pyramid_delete(analysis->pyramid);
+  if(analysis->spectrum != NULL) spectrum_delete(analysis->spectrum);
+  delete analysis;
+}
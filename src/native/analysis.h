@@ -0,0 +1,112 @@
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <DspFilters/Dsp.h>
+
+#include "constants.h"
+#include "samples.h"
+#include "waveform.h"
+#include "spectrum.h"
+#include "impdet.h"
+
+#ifndef ANALYSIS_HEADER_H
+#define ANALYSIS_HEADER_H
+
+static int ANALYSIS_BLOCK = 44100; //samples per block when analyzing stored sources
+static int LOUDNESS_BLOCK = 44100 * 4 / 10; //r128 gating block, 400ms
+static int LOUDNESS_STEP = 44100 / 10; //75% overlap
+static double LOUDNESS_ABSOLUTE_GATE = -70; //LUFS
+static double LOUDNESS_RELATIVE_GATE = -10; //LU below the absolute gated loudness
+
+/* everything derived from a source's samples, built in one pass while it loads */
+typedef struct{
+  waveformPyramid* pyramid;
+  spectrumPyramid* spectrum;
+  std::vector<float> onsets; //high passed energy per IMPDET_WINSIZE window
+  double loudness; //integrated EBU R128, LUFS
+  float peak; //sample peak over all channels
+  uint64_t hash; //of the decoded samples, identifies the content for caches
+} sourceAnalysis;
+
+/* sees every sample of a source once, in order, then writes its result */
+class Analyzer {
+  public:
+    virtual ~Analyzer(){}
+    virtual void process(float** channels, int count) = 0;
+    virtual void finish(sourceAnalysis* analysis, int length) = 0;
+};
+
+class PyramidAnalyzer: public Analyzer{
+  public:
+    PyramidAnalyzer();
+    void process(float** channels, int count);
+    void finish(sourceAnalysis* analysis, int length);
+  private:
+    waveformPyramid* pyramid;
+    std::vector<float> pending; //samples short of a whole bin
+    int bins;
+};
+
+class SpectrumAnalyzer: public Analyzer{
+  public:
+    SpectrumAnalyzer();
+    void process(float** channels, int count);
+    void finish(sourceAnalysis* analysis, int length);
+  private:
+    spectrumBuilder* builder;
+};
+
+class OnsetAnalyzer: public Analyzer{
+  public:
+    OnsetAnalyzer();
+    ~OnsetAnalyzer();
+    void process(float** channels, int count);
+    void finish(sourceAnalysis* analysis, int length);
+  private:
+    Dsp::Filter* filter;
+    float* window;
+    int windowUsed;
+    std::vector<float> energies;
+};
+
+class LoudnessAnalyzer: public Analyzer{
+  public:
+    LoudnessAnalyzer();
+    void process(float** channels, int count);
+    void finish(sourceAnalysis* analysis, int length);
+  private:
+    double shelf[5]; //k-weighting biquads, b0 b1 b2 a1 a2
+    double highpass[5];
+    double state[CHANNEL_COUNT][4]; //direct form ii per channel, two per biquad
+    double stepEnergy; //k-weighted energy over the current step
+    int stepUsed;
+    std::vector<double> steps; //energy per LOUDNESS_STEP
+    float peak;
+};
+
+/* content hash over the float bits, HASH_LANES interleaved so it doesn't stall on the multiply */
+static const int HASH_LANES = 4;
+
+class HashAnalyzer: public Analyzer{
+  public:
+    HashAnalyzer();
+    void process(float** channels, int count);
+    void finish(sourceAnalysis* analysis, int length);
+  private:
+    uint64_t lanes[CHANNEL_COUNT][HASH_LANES];
+    uint64_t position;
+};
+
+/* the analyzers run on every load */
+std::vector<Analyzer*> analyzers_new();
+
+/* finish and free the analyzers, collecting their results */
+sourceAnalysis* analyzers_finish(std::vector<Analyzer*>& analyzers, int length);
+
+/* run all analyzers over channels already in memory */
+sourceAnalysis* analysis_run(std::vector<void*>& channels, int format, int length);
+
+void analysis_delete(sourceAnalysis* analysis);
+
+#endif
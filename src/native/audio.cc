@@ -4,19 +4,25 @@ static streamState state;
 static PaStream * gstream = NULL;
 static PaStream * pstream = NULL;
 
+static std::mutex recordingLock; //poller vs js thread, the callback never waits on it
+
 void poller(){
   while(true){
-    /* allocate new recording chunk as needed */
-    if(
-      state.recording != NULL 
-      && state.recording->chunkIndex == state.recording->chunks.size()-1
-    ){
-      recordChunk* currentChunk = state.recording->chunks[state.recording->chunkIndex];
-      if(currentChunk->used > currentChunk->size * REC_REALLOC_THRESH){ 
-        allocateChunk(state.recording);
+    {
+      std::lock_guard<std::mutex> lock(recordingLock);
+      recording* rec = state.recording;
+      if(rec != NULL){
+        /* allocate new recording chunk as needed */
+        if(rec->chunkIndex == rec->chunks.size()-1){
+          recordChunk* currentChunk = rec->chunks[rec->chunkIndex];
+          if(currentChunk->used > currentChunk->size * REC_REALLOC_THRESH){ 
+            allocateChunk(rec);
+          }
+        }
+        updateRecordingPyramid(rec);
       }
     }
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(REC_POLL_MS));
   }
 }
 std::thread pollThread (poller);
@@ -24,7 +30,12 @@ std::thread pollThread (poller);
 
 Napi::Value init(const Napi::CallbackInfo &info){
   std::string rootPath = info[0].As<Napi::String>().Utf8Value();
-  init_separator(rootPath);
+  init_separator(rootPath, info[2].IsString() ? info[2].As<Napi::String>().Utf8Value() : "model");
+  if(info[1].IsString()){
+    std::string cachePath = info[1].As<Napi::String>().Utf8Value();
+    spectrum_wisdom(cachePath + "/fftw.wisdom");
+    cache_init(cachePath + "/separated");
+  }
 
   Pa_Initialize();
 
@@ -38,6 +49,8 @@ Napi::Value init(const Napi::CallbackInfo &info){
   float* window = new float[WINDOW_SIZE];
   state.window = window;
   state.windowSize = WINDOW_SIZE;
+  state.readBuffer = new float[WINDOW_SIZE];
+  state.sourceFormat = SAMPLE_FLOAT32;
   for(int i=0;i<WINDOW_SIZE;i++)
     window[i] = (cos(M_PI*2*(float(i)/(WINDOW_SIZE-1) + 0.5)) + 1)/2;
 
@@ -209,6 +222,7 @@ Napi::Value removeSource(const Napi::CallbackInfo &info){
   if(REPSYS_LOG) std::cout << "rm src" << std::endl;
   Napi::Env env = info.Env();
   std::string sourceId = info[0].As<Napi::String>().Utf8Value();
+  sweep(); //anything removed earlier is likely let go of by now
   
   if(state.sources.find(sourceId) != state.sources.end() && state.sources[sourceId] != NULL){
     state.sources[sourceId]->removed = true;   
@@ -217,6 +231,18 @@ Napi::Value removeSource(const Napi::CallbackInfo &info){
   return Napi::Boolean::New(env, false);
 }
 
+/* a source about to be replaced under its id. it's marked removed and kept under a spare id, so the
+callback and sweep still find it while anything is reading or writing it */
+static unsigned int retiredCount = 0;
+void retireSource(std::string sourceId){
+  auto found = state.sources.find(sourceId);
+  if(found == state.sources.end() || found->second == NULL) return;
+  source* retired = found->second;
+  retired->removed = true;
+  state.sources[sourceId + "_retired" + std::to_string(++retiredCount)] = retired;
+  state.sources[sourceId] = NULL;
+}
+
 mixTrackPlayback * initMixTrackPlayback(){
   mixTrackPlayback * playback = new mixTrackPlayback{};
   playback->chunkIndex = -1;
@@ -316,6 +342,128 @@ void setMixTrackPlayback(mixTrackPlayback * playback, Napi::Value value){
   }
 }
 
+Dsp::Filter* newTrackFilter(){
+  Dsp::Filter* filter = new Dsp::SmoothedFilterDesign<Dsp::RBJ::Design::LowPass, CHANNEL_COUNT> (WINDOW_SIZE * 4);
+  setFilterCutoff(filter, 1);
+  return filter;
+}
+
+/* a track with its own pipeline and no timing slot yet */
+mixTrack* newMixTrack(){
+  mixTrack * newMixTrack = new mixTrack{};
+  newMixTrack->playback = initMixTrackPlayback();
+  newMixTrack->nextPlayback = NULL;
+  newMixTrack->hasNext = false;
+  newMixTrack->hasFilter = false;
+  newMixTrack->lastCommit = 0.;
+  newMixTrack->sample = 0;
+  newMixTrack->phase = 0.;
+  newMixTrack->overlapIndex = 0;
+  newMixTrack->removed = false;
+  newMixTrack->safe = false;
+  newMixTrack->gain = 0.;
+  newMixTrack->level = 0.;
+  newMixTrack->timingSlot = -1;
+  newMixTrack->automation = automation_new();
+  newMixTrack->automationGain = new float[AUTOMATION_FRAMES];
+
+  newMixTrack->delayBuffer = ringbuffer_new(DELAY_MAX_SIZE);
+
+  newMixTrack->pvstretcher = new PVStretcher();
+  newMixTrack->restretcher = new REStretcher();
+
+  newMixTrack->stretchInput = new float*[CHANNEL_COUNT];
+  newMixTrack->stretchOutput = new float*[CHANNEL_COUNT];
+  for(int i=0;i<CHANNEL_COUNT;i++) newMixTrack->stretchInput[i] = new float[WINDOW_SIZE*8];
+  for(int i=0;i<CHANNEL_COUNT;i++) newMixTrack->stretchOutput[i] = new float[WINDOW_SIZE*8];
+
+  newMixTrack->inputBuffer = ringbuffer_new(WINDOW_SIZE * 16);
+
+  newMixTrack->filter = newTrackFilter();
+
+  newMixTrack->preroll = new mixTrackPreroll{};
+  newMixTrack->preroll->switchFrame = -1;
+  newMixTrack->preroll->pvstretcher = new PVStretcher();
+  newMixTrack->preroll->restretcher = new REStretcher();
+  newMixTrack->preroll->inputBuffer = ringbuffer_new(WINDOW_SIZE * 16);
+  newMixTrack->preroll->filter = newTrackFilter();
+
+  newMixTrack->prestretch = NULL;
+  newMixTrack->prestretchStable = 0;
+  newMixTrack->prestretching = false;
+  newMixTrack->prestretchActive = false;
+  newMixTrack->prestretchLeaving = false;
+
+  newMixTrack->freeze = NULL;
+  newMixTrack->swapped = false;
+  return newMixTrack;
+}
+
+mixTrackPlayback* copyPlayback(mixTrackPlayback* playback){
+  mixTrackPlayback* copy = new mixTrackPlayback(*playback);
+  for(auto sourcePair: copy->sourceTracksParams)
+    copy->sourceTracksParams[sourcePair.first] = new mixTrackSourceConfig(*sourcePair.second);
+  return copy;
+}
+
+void deletePlayback(mixTrackPlayback* playback){
+  for(auto sourcePair: playback->sourceTracksParams) delete sourcePair.second;
+  delete playback;
+}
+
+/* whether two playbacks render the same, leaving out what a frozen track still applies live */
+bool samePlayback(mixTrackPlayback* a, mixTrackPlayback* b){
+  if(
+    a->chunks != b->chunks || a->alpha != b->alpha || a->filter != b->filter || a->loop != b->loop ||
+    a->aperiodic != b->aperiodic || a->preservePitch != b->preservePitch ||
+    a->sourceTracksParams.size() != b->sourceTracksParams.size()
+  ) return false;
+  for(auto sourcePair: a->sourceTracksParams){
+    auto found = b->sourceTracksParams.find(sourcePair.first);
+    if(
+      found == b->sourceTracksParams.end() || found->second->volume != sourcePair.second->volume ||
+      found->second->offset != sourcePair.second->offset
+    ) return false;
+  }
+  return true;
+}
+
+bool isFrozen(mixTrack* track){
+  return track->freeze != NULL && !track->freeze->removed;
+}
+
+/* put a frozen track back on its own playback. the frozen one is freed by sweep once the callback is off it */
+void thawMixTrack(mixTrack* track){
+  mixTrackFreeze* freeze = track->freeze;
+  if(REPSYS_LOG) std::cout << "thaw " << freeze->sourceId << std::endl;
+  track->playback = freeze->playback;
+  track->swapped = true;
+  updateMixTrackFilter(track);
+  freeze->removed = true;
+  auto found = state.sources.find(freeze->sourceId);
+  if(found != state.sources.end() && found->second != NULL) found->second->removed = true;
+}
+
+/* after the own playback of a frozen track changes: thaw if it no longer sounds like the render, otherwise
+carry over what's still applied live */
+void updateFreeze(mixTrack* track){
+  mixTrackFreeze* freeze = track->freeze;
+  if(!samePlayback(freeze->playback, freeze->rendered)){
+    thawMixTrack(track);
+    return;
+  }
+  freeze->frozen->volume = freeze->playback->volume;
+  freeze->frozen->muted = freeze->playback->muted;
+  freeze->frozen->playing = freeze->playback->playing;
+  freeze->frozen->preview = freeze->playback->preview;
+}
+
+void freeFreeze(mixTrackFreeze* freeze){
+  deletePlayback(freeze->frozen);
+  deletePlayback(freeze->rendered);
+  delete freeze;
+}
+
 void setMixTrack(const Napi::CallbackInfo &info){
   std::string mixTrackId = info[0].As<Napi::String>().Utf8Value();
   Napi::Object update = info[1].As<Napi::Object>();
@@ -324,56 +472,24 @@ void setMixTrack(const Napi::CallbackInfo &info){
   if(REPSYS_LOG) std::cout << "set track " << mixTrackId << std::endl;
 
   if(state.mixTracks.find(mixTrackId) == state.mixTracks.end() || state.mixTracks[mixTrackId] == NULL){
-    mixTrack * newMixTrack = new mixTrack{};
-    newMixTrack->playback = initMixTrackPlayback();
-    newMixTrack->nextPlayback = NULL;
-    newMixTrack->hasNext = false;
-    newMixTrack->hasFilter = false;
-    newMixTrack->lastCommit = 0.;
-    newMixTrack->sample = 0;
-    newMixTrack->phase = 0.;
-    newMixTrack->overlapIndex = 0;
-    newMixTrack->removed = false;
-    newMixTrack->safe = false;
-    newMixTrack->gain = 0.;
-
-    newMixTrack->delayBuffer = ringbuffer_new(DELAY_MAX_SIZE);
-
-    newMixTrack->pvstretcher = new PVStretcher();
-    newMixTrack->restretcher = new REStretcher();
-
-    newMixTrack->stretchInput = new float*[CHANNEL_COUNT];
-    newMixTrack->stretchOutput = new float*[CHANNEL_COUNT];
-    for(int i=0;i<CHANNEL_COUNT;i++) newMixTrack->stretchInput[i] = new float[WINDOW_SIZE*8];
-    for(int i=0;i<CHANNEL_COUNT;i++) newMixTrack->stretchOutput[i] = new float[WINDOW_SIZE*8];
-
-    newMixTrack->inputBuffer = ringbuffer_new(WINDOW_SIZE * 16);
-
-    newMixTrack->filter = new Dsp::SmoothedFilterDesign<Dsp::RBJ::Design::LowPass, CHANNEL_COUNT> (WINDOW_SIZE * 4);
-    Dsp::Params params;
-    params[0] = SAMPLE_RATE;
-    params[1] = SAMPLE_RATE/2; // cutoff frequency
-    params[2] = 1.25; // Q
-    newMixTrack->filter->setParams(params);
-
-    state.mixTracks[mixTrackId] = newMixTrack;
+    mixTrack* newTrack = newMixTrack();
+    newTrack->timingSlot = timing_slot_new();
+    state.mixTracks[mixTrackId] = newTrack;
   }
 
   mixTrack* mixTrack = state.mixTracks[mixTrackId];
-  setMixTrackPlayback(mixTrack->playback, playback);
+  if(isFrozen(mixTrack)){
+    setMixTrackPlayback(mixTrack->freeze->playback, playback);
+    updateFreeze(mixTrack);
+  }else setMixTrackPlayback(mixTrack->playback, playback);
 
-  if(playback.As<Napi::Object>().Has("filter")){
-    Dsp::Params params;
-    params[0] = SAMPLE_RATE;
-    params[1] = SAMPLE_RATE/2 * mixTrack->playback->filter; // cutoff frequency
-    params[2] = 1.25; // Q
-    mixTrack->filter->setParams(params);
-  }
+  if(playback.As<Napi::Object>().Has("filter")) updateMixTrackFilter(mixTrack);
     
   if(!nextPlayback.IsUndefined()){
     if(nextPlayback.IsNull()){
       mixTrack->hasNext = false;
     }else {
+      if(isFrozen(mixTrack)) thawMixTrack(mixTrack);
       mixTrack->nextPlayback = initMixTrackPlayback();
       setMixTrackPlayback(state.mixTracks[mixTrackId]->nextPlayback, nextPlayback);
       mixTrack->hasNext = true;
@@ -381,10 +497,107 @@ void setMixTrack(const Napi::CallbackInfo &info){
   }
 }
 
+void setPlaybackParam(int param, double value){
+  switch(param){
+    case PARAM_VOLUME: state.playback->volume = value; break;
+    case PARAM_TIME: state.playback->time = value; break;
+    case PARAM_PLAYING: state.playback->playing = value != 0; break;
+    case PARAM_PERIOD: state.playback->period = value; break;
+  }
+}
+
+void setTrackParam(mixTrack* mixTrack, int param, double value){
+  mixTrackPlayback* playback = isFrozen(mixTrack) ? mixTrack->freeze->playback : mixTrack->playback;
+  switch(param){
+    case TRACK_PARAM_CHUNK_INDEX: playback->chunkIndex = value; break;
+    case TRACK_PARAM_ALPHA: playback->alpha = value; break;
+    case TRACK_PARAM_VOLUME: playback->volume = value; break;
+    case TRACK_PARAM_PLAYING: playback->playing = value != 0; break;
+    case TRACK_PARAM_LOOP: playback->loop = value != 0; break;
+    case TRACK_PARAM_MUTED: playback->muted = value != 0; break;
+    case TRACK_PARAM_FILTER:
+      playback->filter = value;
+      updateMixTrackFilter(mixTrack);
+      break;
+    case TRACK_PARAM_DELAY: playback->delay = value; break;
+    case TRACK_PARAM_DELAY_GAIN: playback->delayGain = value; break;
+    case TRACK_PARAM_APERIODIC: playback->aperiodic = value != 0; break;
+    case TRACK_PARAM_PRESERVE_PITCH: playback->preservePitch = value != 0; break;
+    case TRACK_PARAM_PREVIEW: playback->preview = value != 0; break;
+    case TRACK_PARAM_NEXT_AT_CHUNK: playback->nextAtChunk = value != 0; break;
+    case TRACK_PARAM_UNPAUSE: playback->unpause = value != 0; break;
+  }
+  if(isFrozen(mixTrack)) updateFreeze(mixTrack);
+}
+
+/* scalar updates for any number of tracks in one call. targets and params are pairs in ids, the target
+indexing trackIds or PARAMS_GLOBAL, with the value at the same index in values. see params.h */
+void setParams(const Napi::CallbackInfo &info){
+  Napi::Array trackIdsArray = info[0].As<Napi::Array>();
+  Napi::Int32Array ids = info[1].As<Napi::Int32Array>();
+  Napi::Float64Array values = info[2].As<Napi::Float64Array>();
+  if(REPSYS_LOG) std::cout << "set params " << values.ElementLength() << std::endl;
+
+  /* resolve each track once rather than once per param */
+  std::vector<mixTrack*> tracks;
+  for(uint32_t i=0;i<trackIdsArray.Length();i++){
+    auto found = state.mixTracks.find(trackIdsArray.Get(i).As<Napi::String>().Utf8Value());
+    tracks.push_back(found != state.mixTracks.end() && found->second != NULL && !found->second->removed ? found->second : NULL);
+  }
+
+  size_t count = std::min(values.ElementLength(), ids.ElementLength() / 2);
+  for(size_t i=0;i<count;i++){
+    int target = ids[i*2];
+    int param = ids[i*2+1];
+    if(target == PARAMS_GLOBAL) setPlaybackParam(param, values[i]);
+    else if(target >= 0 && target < (int)tracks.size() && tracks[target] != NULL)
+      setTrackParam(tracks[target], param, values[i]);
+  }
+}
+
+mixTrack* getMixTrack(std::string mixTrackId){
+  auto found = state.mixTracks.find(mixTrackId);
+  return found != state.mixTracks.end() && found->second != NULL && !found->second->removed ? found->second : NULL;
+}
+
+/* schedule automation points for a track, packed as param, at, phase, value, ramp. at is an output frame
+or with phase set a transport time. returns how many were queued, the rest didn't fit */
+Napi::Value automate(const Napi::CallbackInfo &info){
+  Napi::Env env = info.Env();
+  mixTrack* track = getMixTrack(info[0].As<Napi::String>().Utf8Value());
+  Napi::Float64Array packed = info[1].As<Napi::Float64Array>();
+  if(track == NULL) return Napi::Number::New(env, 0);
+
+  size_t count = packed.ElementLength() / 5, queued = 0;
+  for(;queued<count;queued++){
+    automationPoint point{};
+    point.param = packed[queued*5];
+    point.at = packed[queued*5+1];
+    point.phase = packed[queued*5+2] != 0;
+    point.value = packed[queued*5+3];
+    point.ramp = packed[queued*5+4] != 0;
+    /* the render has alpha and filter baked in */
+    if(isFrozen(track) && (point.param == AUTOMATE_ALPHA || point.param == AUTOMATE_FILTER)) thawMixTrack(track);
+    if(!automation_push(track->automation, point)) break;
+  }
+  return Napi::Number::New(env, queued);
+}
+
+/* drop a track's scheduled points for one param, or all of them */
+void clearAutomation(const Napi::CallbackInfo &info){
+  mixTrack* track = getMixTrack(info[0].As<Napi::String>().Utf8Value());
+  if(track == NULL) return;
+  automationPoint clear{};
+  clear.param = AUTOMATE_CLEAR;
+  clear.value = info.Length() > 1 && info[1].IsNumber() ? info[1].As<Napi::Number>().Int32Value() : -1;
+  automation_push(track->automation, clear);
+}
+
 Napi::Value removeMixTrack(const Napi::CallbackInfo &info){
   if(REPSYS_LOG) std::cout << "rm track" << std::endl;
   Napi::Env env = info.Env();
   std::string mixTrackId = info[0].As<Napi::String>().Utf8Value();
+  sweep();
 
   if(state.mixTracks[mixTrackId] == NULL) return Napi::Boolean::New(env, false);
   
@@ -395,6 +608,77 @@ Napi::Value removeMixTrack(const Napi::CallbackInfo &info){
   return Napi::Boolean::New(env, false);
 }
 
+/* wrap loaded responses in a buffer that sources can share, registered under key if it has one */
+sourceBuffer* newBuffer(std::string key, std::string sourceId, std::vector<loadResponse *> &loadResponses){
+  sourceBuffer* buffer = new sourceBuffer{};
+  buffer->key = key;
+  buffer->refs = 0;
+  buffer->format = SAMPLE_FLOAT32;
+  for(unsigned int i=0;i<loadResponses.size();i++){
+    loadResponse* res = loadResponses[i];
+    buffer->suffixes.push_back(res->sourceId.substr(sourceId.size()));
+    buffer->streams.push_back(res->channels);
+    buffer->lengths.push_back(res->length);
+    buffer->analyses.push_back(res->analysis);
+    buffer->format = res->format;
+    delete res;
+  }
+  loadResponses.clear();
+  if(key.size()) state.buffers[key] = buffer;
+  return buffer;
+}
+
+void releaseBuffer(sourceBuffer* buffer){
+  if(--buffer->refs > 0) return;
+  if(REPSYS_LOG) std::cout << "free buffer " << buffer->key << std::endl;
+  auto registered = state.buffers.find(buffer->key);
+  if(registered != state.buffers.end() && registered->second == buffer) state.buffers.erase(registered);
+  for(unsigned int i=0;i<buffer->streams.size();i++){
+    if(i < buffer->mappings.size()) cache_unmap(buffer->mappings[i]);
+    else for(unsigned int c=0;c<buffer->streams[i].size();c++)
+      samples_delete(buffer->streams[i][c], buffer->format);
+    if(buffer->analyses[i] != NULL) analysis_delete(buffer->analyses[i]);
+  }
+  delete buffer;
+}
+
+/* a buffer over mapped cache files, one stream per mapping. analyses are filled in later */
+sourceBuffer* newMappedBuffer(std::string key, std::vector<std::string> suffixes, std::vector<cacheMapping*> mappings){
+  sourceBuffer* buffer = new sourceBuffer{};
+  buffer->key = key;
+  buffer->refs = 0;
+  buffer->format = SAMPLE_FLOAT32;
+  buffer->suffixes = suffixes;
+  buffer->mappings = mappings;
+  for(unsigned int i=0;i<mappings.size();i++){
+    buffer->streams.push_back(mappings[i]->channels);
+    buffer->lengths.push_back(mappings[i]->length);
+    buffer->analyses.push_back(NULL);
+  }
+  if(key.size()) state.buffers[key] = buffer;
+  return buffer;
+}
+
+/* add a source for each stream in the buffer, returns their ids */
+Napi::Array addBufferSources(Napi::Env env, std::string sourceId, sourceBuffer* buffer){
+  Napi::Array loadedSources = Napi::Array::New(env);
+  for(unsigned int i=0;i<buffer->streams.size();i++){
+    std::string sourceTrackId = sourceId + buffer->suffixes[i];
+    source * newSource = new source{};
+    newSource->length = buffer->lengths[i];
+    newSource->format = buffer->format;
+    newSource->buffer = buffer;
+    newSource->analysis = buffer->analyses[i];
+    newSource->removed = false;
+    newSource->safe = false;
+    newSource->channels = buffer->streams[i];
+    buffer->refs++;
+    state.sources[sourceTrackId] = newSource;
+    loadedSources.Set(i, sourceTrackId);
+  }
+  return loadedSources;
+}
+
 Napi::Object getPlaybackTiming(Napi::Env env, mixTrackPlayback * playback){
   Napi::Object mixTrackPlayback = Napi::Object::New(env);
   mixTrackPlayback.Set("chunkIndex", playback->chunkIndex);
@@ -402,123 +686,800 @@ Napi::Object getPlaybackTiming(Napi::Env env, mixTrackPlayback * playback){
   return mixTrackPlayback;
 }
 
-Napi::Value getTiming(const Napi::CallbackInfo &info){
-  //std::cout << "get timing" << std::endl;
+void freePrestretch(prestretchLoop* loop){
+  for(unsigned int c=0;c<loop->channels.size();c++) delete [] loop->channels[c];
+  delete loop;
+}
+
+/* the config a track's loop would be prestretched from, false unless it's a looping, periodic, pitch
+preserving playback whose sources can all be read */
+bool getPrestretchConfig(mixTrack* track, prestretchConfig* config){
+  mixTrackPlayback* playback = track->playback;
+  int period = state.playback->period;
+  int chunkCount = playback->chunks.size() / 2;
+  if(
+    !playback->playing || !playback->loop || playback->aperiodic || !playback->preservePitch || track->hasNext ||
+    chunkCount == 0 || period <= 0 || playback->alpha <= 0 || period / playback->alpha * chunkCount > PRESTRETCH_MAX
+  ) return false;
+  for(int k=0;k<chunkCount;k++) if(playback->chunks[k*2+1] <= 0) return false;
+
+  config->playback = playback;
+  config->chunks = playback->chunks;
+  config->alpha = playback->alpha;
+  config->period = period;
+  config->sources.clear();
+  for(auto sourcePair: playback->sourceTracksParams){
+    mixTrackSourceConfig* params = sourcePair.second;
+    if(params->volume != 0){
+      auto found = state.sources.find(sourcePair.first);
+      if(found == state.sources.end() || found->second == NULL || found->second->removed) return false;
+      if(found->second->separating != NULL) return false; //stems still filling in
+    }
+    config->sources.push_back(prestretchSource{sourcePair.first, params, params->volume, params->offset});
+  }
+  return true;
+}
+
+class PrestretchWorker : public Napi::AsyncWorker {
+  public:
+    PrestretchWorker(
+      Napi::Env &env,
+      std::string mixTrackId,
+      prestretchConfig config
+    ): Napi::AsyncWorker(env),
+       mixTrackId(mixTrackId),
+       loop(new prestretchLoop{}){
+      loop->config = config;
+      for(unsigned int i=0;i<config.sources.size();i++){
+        source* mixSource = config.sources[i].volume != 0 ? state.sources[config.sources[i].sourceId] : NULL;
+        if(mixSource != NULL) mixSource->readers++;
+        sources.push_back(mixSource);
+      }
+    }
+
+    ~PrestretchWorker() {}
+    void Execute() {
+      prestretchConfig& config = loop->config;
+      int chunkCount = config.chunks.size() / 2;
+      std::vector<int> chunkLengths;
+      size_t loopLength = 0;
+      for(int k=0;k<chunkCount;k++){
+        chunkLengths.push_back(config.chunks[k*2+1]);
+        loopLength += config.chunks[k*2+1];
+      }
+
+      /* mix the chunks back to back, as the track's sources would be read */
+      float* in[CHANNEL_COUNT];
+      for(int c=0;c<CHANNEL_COUNT;c++) in[c] = new float[loopLength]();
+      float* read = new float[PRESTRETCH_BLOCK];
+      for(unsigned int i=0;i<sources.size();i++){
+        source* mixSource = sources[i];
+        if(mixSource == NULL) continue;
+        prestretchSource& configSource = config.sources[i];
+        size_t position = 0;
+        for(int k=0;k<chunkCount;k++){
+          for(int done=0;done<chunkLengths[k];done+=PRESTRETCH_BLOCK){
+            int count = std::min(PRESTRETCH_BLOCK, chunkLengths[k] - done);
+            int start = config.chunks[k*2] + done - configSource.offset;
+            for(int c=0;c<CHANNEL_COUNT;c++){
+              samples_read(mixSource->channels[c], mixSource->format, mixSource->length, start, count, read);
+              for(int j=0;j<count;j++) in[c][position + done + j] += read[j] * configSource.volume;
+            }
+          }
+          position += chunkLengths[k];
+        }
+      }
+      delete [] read;
+
+      loop->chunkOut = (double)config.period / config.alpha;
+      loop->chunkFrames = ceil(loop->chunkOut);
+      for(int c=0;c<CHANNEL_COUNT;c++) loop->channels.push_back(new float[(size_t)loop->chunkFrames * chunkCount]);
+      bool rendered = prestretch_render(in, chunkLengths, loop->chunkOut, loop->chunkFrames, loop->channels.data());
+      for(int c=0;c<CHANNEL_COUNT;c++) delete [] in[c];
+      if(!rendered) SetError("prestretch failed");
+    }
+    void OnOK() {
+      release();
+      mixTrack* track = getMixTrack(mixTrackId);
+      /* the track may have moved on while this ran */
+      if(track != NULL && track->prestretch == NULL && prestretchMatches(&state, &loop->config, track)){
+        if(REPSYS_LOG) std::cout << "prestretched " << mixTrackId << std::endl;
+        track->prestretch = loop;
+      }else freePrestretch(loop);
+    }
+    void OnError(Napi::Error const &error) {
+      release();
+      freePrestretch(loop);
+    }
+  private:
+    std::string mixTrackId;
+    prestretchLoop* loop;
+    std::vector<source*> sources;
+    void release(){
+      for(unsigned int i=0;i<sources.size();i++) if(sources[i] != NULL) sources[i]->readers--;
+      auto found = state.mixTracks.find(mixTrackId);
+      if(found != state.mixTracks.end() && found->second != NULL) found->second->prestretching = false;
+    }
+};
+
+/* drop loops their tracks have moved off of, and prestretch tracks that have sat on the same loop
+through PRESTRETCH_STABLE checks */
+void updatePrestretch(Napi::Env env){
+  for(auto mixTrackPair: state.mixTracks){
+    mixTrack* track = mixTrackPair.second;
+    if(track == NULL || track->removed) continue;
+    prestretchLoop* loop = track->prestretch;
+    if(loop != NULL && !loop->removed && !prestretchMatches(&state, &loop->config, track)){
+      if(REPSYS_LOG) std::cout << "drop prestretch " << mixTrackPair.first << std::endl;
+      loop->removed = true;
+    }
+
+    prestretchConfig config{};
+    bool eligible = getPrestretchConfig(track, &config);
+    if(eligible && prestretchMatches(&state, &track->prestretchSeen, track)) track->prestretchStable++;
+    else track->prestretchStable = 0;
+    track->prestretchSeen = config;
+
+    if(eligible && track->prestretchStable >= PRESTRETCH_STABLE && track->prestretch == NULL && !track->prestretching){
+      track->prestretching = true;
+      PrestretchWorker* worker = new PrestretchWorker(env, mixTrackPair.first, config);
+      worker->Queue();
+    }
+  }
+}
+
+void deleteMixTrack(mixTrack* mixTrack){
+  if(mixTrack->timingSlot >= 0) timing_slot_free(mixTrack->timingSlot);
+  automation_delete(mixTrack->automation);
+  delete [] mixTrack->automationGain;
+  ringbuffer_delete(mixTrack->delayBuffer);
+  ringbuffer_delete(mixTrack->inputBuffer);
+  delete mixTrack->pvstretcher;
+  delete mixTrack->restretcher;
+  for(int i=0;i<CHANNEL_COUNT;i++){
+    delete [] mixTrack->stretchInput[i];
+    delete [] mixTrack->stretchOutput[i];
+  }
+  delete [] mixTrack->stretchInput;
+  delete [] mixTrack->stretchOutput;
+  delete mixTrack->filter;
+  ringbuffer_delete(mixTrack->preroll->inputBuffer);
+  delete mixTrack->preroll->pvstretcher;
+  delete mixTrack->preroll->restretcher;
+  delete mixTrack->preroll->filter;
+  delete mixTrack->preroll;
+  if(mixTrack->prestretch != NULL) freePrestretch(mixTrack->prestretch);
+  if(mixTrack->freeze != NULL){
+    if(!mixTrack->freeze->removed) thawMixTrack(mixTrack);
+    freeFreeze(mixTrack->freeze);
+  }
+  delete mixTrack;
+}
+
+static int freezeCount = 0;
+
+/* chunks that each last 1/alpha periods and are fit to them, so the track comes round every chunkCount/alpha */
+bool freezePeriodic(mixTrackPlayback* playback){
+  int chunkCount = playback->chunks.size() / 2;
+  bool periodic = chunkCount > 0 && !playback->aperiodic && playback->alpha > 0;
+  for(int k=0;k<chunkCount;k++) if(playback->chunks[k*2+1] == 0) periodic = false;
+  return periodic;
+}
+
+/* periods a render of bars holds. a periodic loop's is rounded to whole cycles of it, or it would seam
+where the render loops */
+double freezePeriods(mixTrackPlayback* playback, int bars){
+  if(!freezePeriodic(playback)) return bars;
+  double cycle = (playback->chunks.size() / 2) / playback->alpha;
+  return std::max(round(bars / cycle), 1.) * cycle;
+}
+
+class FreezeWorker : public Napi::AsyncWorker {
+  public:
+    FreezeWorker(
+      Napi::Env &env,
+      std::string mixTrackId,
+      mixTrack* track,
+      double periods
+    ): Napi::AsyncWorker(env),
+       deferred(Napi::Promise::Deferred::New(env)),
+       mixTrackId(mixTrackId),
+       period(state.playback->period),
+       format(state.sourceFormat),
+       length(round(periods * state.playback->period)),
+       rendered(copyPlayback(track->playback)){
+      /* the frozen playback reads frame frac(time/periods)*length at time, the render has to line up with that */
+      double time = state.playback->time;
+      if(freezePeriodic(rendered)){
+        /* chunks turn over where alpha*time is whole. starting on the one that was heard at time 0, frame 
+        r is what the track plays at r/period */
+        int chunkCount = rendered->chunks.size() / 2;
+        int passed = ((long long)floor(rendered->alpha * time)) % chunkCount;
+        startChunk = ((heardChunk(track, time) - passed) % chunkCount + chunkCount) % chunkCount;
+        startSample = rendered->chunks[startChunk * 2];
+        offset = 0;
+      }else{
+        /* nothing to line up with, it picks up where the track is now and is rotated to be read from there */
+        startChunk = rendered->chunkIndex;
+        startSample = track->sample;
+        double phase = time / periods;
+        offset = std::min((int)((phase - floor(phase)) * length), length - 1);
+      }
+      for(auto sourcePair: rendered->sourceTracksParams){
+        auto found = state.sources.find(sourcePair.first);
+        if(found == state.sources.end() || found->second == NULL || found->second->removed) continue;
+        found->second->readers++;
+        sources[sourcePair.first] = found->second;
+      }
+    }
+
+    ~FreezeWorker() {}
+    void Execute() {
+      /* the track alone through the same callback as live, with nothing published from it */
+      streamState offline{};
+      offline.offline = true;
+      offline.playback = new playback{};
+      offline.playback->period = period;
+      offline.playback->playing = true;
+      offline.playback->volume = 1;
+      offline.window = state.window;
+      offline.readBuffer = new float[WINDOW_SIZE];
+      offline.previewBuffer = ringbuffer_new(1024);
+      offline.sourceFormat = format;
+      offline.recording = NULL;
+      offline.sources = sources;
+
+      mixTrack* track = newMixTrack();
+      deletePlayback(track->playback);
+      track->playback = copyPlayback(rendered);
+      mixTrackPlayback* trackPlayback = track->playback;
+      trackPlayback->volume = 1;
+      trackPlayback->muted = false;
+      trackPlayback->playing = true;
+      trackPlayback->preview = false;
+      track->gain = 1;
+      updateMixTrackFilter(track);
+      offline.mixTracks[mixTrackId] = track;
+
+      /* periodic loops start a chunk early on the one before, so the render opens on a warm pipeline */
+      int chunkCount = trackPlayback->chunks.size() / 2;
+      int warm = 0;
+      trackPlayback->chunkIndex = startChunk;
+      track->sample = startSample;
+      if(freezePeriodic(trackPlayback)){
+        warm = std::min((int)round(period / trackPlayback->alpha), FREEZE_MAX);
+        trackPlayback->chunkIndex = (startChunk + chunkCount - 1) % chunkCount;
+        track->sample = trackPlayback->chunks[trackPlayback->chunkIndex * 2];
+      }
+      offline.playback->time = -(double)warm / period;
+
+      float* out = new float[FREEZE_BLOCK * CHANNEL_COUNT];
+      float* planar = new float[FREEZE_BLOCK];
+      for(int c=0;c<CHANNEL_COUNT;c++) channels.push_back(samples_new(length, format));
+      int count;
+      for(int at=-warm;at<length;at+=count){
+        count = std::min(FREEZE_BLOCK, at < 0 ? -at : length - at);
+        paCallbackMethod(NULL, out, count, NULL, 0, &offline);
+        if(at < 0) continue;
+        int to = (at + offset) % length;
+        int first = std::min(count, length - to);
+        for(int c=0;c<CHANNEL_COUNT;c++){
+          for(int i=0;i<count;i++) planar[i] = out[i*CHANNEL_COUNT + c];
+          samples_encode(planar, channels[c], to, first, format);
+          if(first < count) samples_encode(planar + first, channels[c], 0, count - first, format);
+        }
+      }
+
+      delete [] out;
+      delete [] planar;
+      deletePlayback(track->playback);
+      deleteMixTrack(track);
+      delete offline.playback;
+      delete [] offline.readBuffer;
+      ringbuffer_delete(offline.previewBuffer);
+    }
+    void OnOK() {
+      Napi::Env env = Env();
+      Napi::HandleScope scope(env);
+      release();
+      mixTrack* track = getMixTrack(mixTrackId);
+      /* the track may have moved on while this ran */
+      if(
+        track == NULL || track->freeze != NULL || track->hasNext || !samePlayback(track->playback, rendered) ||
+        state.playback->period != period
+      ){
+        for(unsigned int c=0;c<channels.size();c++) samples_delete(channels[c], format);
+        deletePlayback(rendered);
+        deferred.Resolve(env.Null());
+        return;
+      }
+
+      std::string sourceId = mixTrackId + "_frozen" + std::to_string(++freezeCount);
+      source* frozenSource = new source{};
+      frozenSource->channels = channels;
+      frozenSource->format = format;
+      frozenSource->length = length;
+      frozenSource->buffer = NULL;
+      frozenSource->analysis = NULL;
+      frozenSource->separating = NULL;
+      frozenSource->removed = false;
+      frozenSource->safe = false;
+      state.sources[sourceId] = frozenSource;
+
+      /* one chunk of the whole render, fit to its periods so it's never stretched */
+      mixTrackPlayback* frozen = initMixTrackPlayback();
+      frozen->chunks = {0, length};
+      frozen->alpha = (double)period / length;
+      frozen->chunkIndex = 0;
+      frozen->filter = 1;
+      frozen->sourceTracksParams[sourceId] = new mixTrackSourceConfig{1, 0, false};
+
+      mixTrackFreeze* freeze = new mixTrackFreeze{};
+      freeze->sourceId = sourceId;
+      freeze->playback = track->playback;
+      freeze->frozen = frozen;
+      freeze->rendered = rendered;
+      track->freeze = freeze;
+      updateFreeze(track);
+      track->playback = frozen;
+      track->swapped = true;
+      updateMixTrackFilter(track);
+      if(REPSYS_LOG) std::cout << "froze " << mixTrackId << " to " << sourceId << std::endl;
+      deferred.Resolve(Napi::String::New(env, sourceId));
+    }
+    void OnError(Napi::Error const &error) {
+      release();
+      for(unsigned int c=0;c<channels.size();c++) samples_delete(channels[c], format);
+      deletePlayback(rendered);
+      deferred.Reject(error.Value());
+    }
+    Napi::Promise GetPromise() {
+      return deferred.Promise();
+    }
+  private:
+    Napi::Promise::Deferred deferred;
+    std::string mixTrackId;
+    int period;
+    int format;
+    int length;
+    mixTrackPlayback* rendered;
+    int startChunk; //where the render starts the track off
+    double startSample;
+    int offset; //frame the render's first is written to
+    std::unordered_map<std::string, source*> sources;
+    std::vector<void*> channels;
+    void release(){
+      for(auto sourcePair: sources) sourcePair.second->readers--;
+    }
+};
+
+/* render bars periods of a track's playback as it is now to a source the track then plays instead, 
+faster than real time. a looping track's bars are rounded to whole cycles of its loop. resolves the source's
+id, or null if the track can't be frozen or changed meanwhile */
+Napi::Value freezeMixTrack(const Napi::CallbackInfo &info){
   Napi::Env env = info.Env();
-  Napi::Object timings = Napi::Object::New(env);
-  Napi::Object tracktimings = Napi::Object::New(env);
+  sweep(); //a thaw earlier is likely let go of by now
+  mixTrack* track = getMixTrack(info[0].As<Napi::String>().Utf8Value());
+  int bars = info[1].As<Napi::Number>().Int32Value();
+  int period = state.playback->period;
+  double periods = track != NULL && bars > 0 ? freezePeriods(track->playback, bars) : bars;
+  if(track == NULL || track->freeze != NULL || track->hasNext || bars <= 0 || period <= 0 || periods * period > FREEZE_MAX){
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    deferred.Resolve(env.Null());
+    return deferred.Promise();
+  }
 
-  timings.Set("recTime", state.recording ? state.recording->length : 0);
-  timings.Set("maxLevel", state.playback->maxLevel);
+  FreezeWorker* freezeWorker = new FreezeWorker(env, info[0].As<Napi::String>().Utf8Value(), track, periods);
+  auto promise = freezeWorker->GetPromise();
+  freezeWorker->Queue();
+  return promise;
+}
 
+/* back to a frozen track's own playback, false if it wasn't frozen */
+Napi::Value unfreezeMixTrack(const Napi::CallbackInfo &info){
+  Napi::Env env = info.Env();
+  mixTrack* track = getMixTrack(info[0].As<Napi::String>().Utf8Value());
+  if(track == NULL || !isFrozen(track)) return Napi::Boolean::New(env, false);
+  thawMixTrack(track);
+  return Napi::Boolean::New(env, true);
+}
+
+/* free sources and tracks the callback has let go of, and no async job is still reading */
+void sweep(){
   for(auto sourcesPair: state.sources){
     source* mixTrackSource = sourcesPair.second;
-    if(mixTrackSource && mixTrackSource != NULL && mixTrackSource->safe){
+    if(mixTrackSource && mixTrackSource != NULL && mixTrackSource->safe && !mixTrackSource->readers){
       if(REPSYS_LOG) std::cout << "free source " << sourcesPair.first << std::endl;
-      if(mixTrackSource->data != NULL){
-        av_freep(&mixTrackSource->data[0]);
-        av_freep(&mixTrackSource->data);
-      }else{
+      if(mixTrackSource->buffer != NULL) releaseBuffer(mixTrackSource->buffer);
+      else{
         for(unsigned int channelIndex=0;channelIndex<mixTrackSource->channels.size();channelIndex++){
-          delete [] mixTrackSource->channels[channelIndex];
+          samples_delete(mixTrackSource->channels[channelIndex], mixTrackSource->format);
         }
+        if(mixTrackSource->analysis != NULL) analysis_delete(mixTrackSource->analysis);
       }
+      if(mixTrackSource->separating != NULL && --mixTrackSource->separating->refs == 0)
+        separation_delete(mixTrackSource->separating);
       state.sources[sourcesPair.first] = NULL;
       delete mixTrackSource;
     }
   }
 
-  mixTrack* mixTrack;
   for(auto mixTrackPair: state.mixTracks){
-    mixTrack = mixTrackPair.second;
-    if(mixTrack == NULL) continue;
-    if(mixTrack->safe){
+    mixTrack* mixTrack = mixTrackPair.second;
+    if(mixTrack != NULL && mixTrack->prestretch != NULL && mixTrack->prestretch->safe){
+      freePrestretch(mixTrack->prestretch);
+      mixTrack->prestretch = NULL;
+    }
+    if(mixTrack != NULL && mixTrack->freeze != NULL && mixTrack->freeze->safe){
+      freeFreeze(mixTrack->freeze);
+      mixTrack->freeze = NULL;
+    }
+    if(mixTrack != NULL && mixTrack->safe){
       if(REPSYS_LOG) std::cout << "free track " << mixTrackPair.first << std::endl;
       state.mixTracks[mixTrackPair.first] = NULL;
-      ringbuffer_delete(mixTrack->delayBuffer);
-      ringbuffer_delete(mixTrack->inputBuffer);
-      delete mixTrack;
-    }else{
-      Napi::Object mixTrackState = Napi::Object::New(env);
-      if(mixTrack->playback->playing) mixTrackState.Set("sample", mixTrack->sample);
+      deleteMixTrack(mixTrack);
+    }
+  }
+}
 
-      mixTrackState.Set("playback", getPlaybackTiming(env, mixTrack->playback));
-      if(mixTrack->hasNext)
-        mixTrackState.Set("nextPlayback", getPlaybackTiming(env, mixTrack->nextPlayback));
-      else mixTrackState.Set("nextPlayback", env.Null());
+void sweepRemoved(const Napi::CallbackInfo &info){
+  sweep();
+  updatePrestretch(info.Env());
+}
 
-      tracktimings.Set(mixTrackPair.first, mixTrackState);
-    }
+/* timings as objects, js normally reads the snapshot from getTimingBuffer instead */
+Napi::Value getTiming(const Napi::CallbackInfo &info){
+  Napi::Env env = info.Env();
+  Napi::Object timings = Napi::Object::New(env);
+  Napi::Object tracktimings = Napi::Object::New(env);
+
+  timings.Set("recTime", state.recording ? state.recording->length : 0);
+  timings.Set("maxLevel", state.playback->maxLevel);
+
+  for(auto mixTrackPair: state.mixTracks){
+    mixTrack* mixTrack = mixTrackPair.second;
+    if(mixTrack == NULL || mixTrack->removed) continue;
+    Napi::Object mixTrackState = Napi::Object::New(env);
+    if(mixTrack->playback->playing) mixTrackState.Set("sample", mixTrack->sample);
+
+    mixTrackState.Set("playback", getPlaybackTiming(env, mixTrack->playback));
+    if(mixTrack->hasNext)
+      mixTrackState.Set("nextPlayback", getPlaybackTiming(env, mixTrack->nextPlayback));
+    else mixTrackState.Set("nextPlayback", env.Null());
+
+    tracktimings.Set(mixTrackPair.first, mixTrackState);
   }
   timings.Set("tracks", tracktimings);
   timings.Set("time", state.playback->time);
   return timings;
 }
 
-class SeparateWorker : public Napi::AsyncWorker {
+/* the timing snapshot memory, shared with the audio thread. see timing.h for the layout */
+Napi::Value getTimingBuffer(const Napi::CallbackInfo &info){
+  return Napi::ArrayBuffer::New(info.Env(), timing_buffer(), timing_size());
+}
+
+/* snapshot slot of each track, only changes when the snapshot's slots version does */
+Napi::Value getTimingSlots(const Napi::CallbackInfo &info){
+  Napi::Env env = info.Env();
+  Napi::Object slots = Napi::Object::New(env);
+  for(auto mixTrackPair: state.mixTracks){
+    mixTrack* mixTrack = mixTrackPair.second;
+    if(mixTrack != NULL && !mixTrack->removed && mixTrack->timingSlot >= 0)
+      slots.Set(mixTrackPair.first, mixTrack->timingSlot);
+  }
+  return slots;
+}
+
+/* engine events go to js through a notifier thread, started by the first onEvents */
+static Napi::ThreadSafeFunction eventsTsfn;
+static std::mutex eventsLock;
+static bool notifying = false;
+static const char* EVENT_NAMES[] = {"chunk", "next", "stopped", "phase", "recording"};
+
+void deliverEvents(Napi::Env env, Napi::Function onEvents, std::vector<engineEvent>* events){
+  if(env == nullptr){ //torn down with events still queued
+    delete events;
+    return;
+  }
+  Napi::Array list = Napi::Array::New(env);
+  int count = 0;
+  for(engineEvent event: *events){
+    Napi::Object eventObject = Napi::Object::New(env);
+    if(event.slot >= 0){
+      /* slots are only freed by sweep on this thread, removed tracks' events are dropped */
+      std::string trackId = "";
+      for(auto mixTrackPair: state.mixTracks){
+        mixTrack* mixTrack = mixTrackPair.second;
+        if(mixTrack != NULL && !mixTrack->removed && mixTrack->timingSlot == event.slot) trackId = mixTrackPair.first;
+      }
+      if(trackId.size() == 0) continue;
+      eventObject.Set("trackId", trackId);
+    }
+    eventObject.Set("type", EVENT_NAMES[event.type]);
+    eventObject.Set("value", event.value);
+    eventObject.Set("frame", event.frame);
+    list.Set(count++, eventObject);
+  }
+  delete events;
+  if(count) onEvents.Call({list});
+}
+
+void notifyEvents(){
+  static engineEvent drained[EVENTS_SIZE];
+  while(true){
+    events_wait();
+    int count = events_drain(drained, EVENTS_SIZE);
+    if(count == 0) continue;
+    std::vector<engineEvent>* events = new std::vector<engineEvent>(drained, drained + count);
+    std::lock_guard<std::mutex> guard(eventsLock);
+    if(eventsTsfn.NonBlockingCall(events, deliverEvents) != napi_ok) delete events;
+  }
+}
+
+/* set the function engine events are delivered to, batched per wakeup */
+void onEvents(const Napi::CallbackInfo &info){
+  Napi::Env env = info.Env();
+  Napi::Function callback = info[0].As<Napi::Function>();
+
+  std::lock_guard<std::mutex> guard(eventsLock);
+  if(notifying) eventsTsfn.Release();
+  eventsTsfn = Napi::ThreadSafeFunction::New(env, callback, "engineEvents", 0, 1);
+  eventsTsfn.Unref(env); //don't hold the process open
+  if(!notifying){
+    std::thread(notifyEvents).detach();
+    notifying = true;
+  }
+}
+
+/* where a source is playing, the first mix track using it wins */
+int sourcePlayhead(std::string sourceId){
+  for(auto mixTrackPair: state.mixTracks){
+    mixTrack* track = mixTrackPair.second;
+    if(track == NULL || track->removed) continue;
+    auto params = track->playback->sourceTracksParams.find(sourceId);
+    if(params != track->playback->sourceTracksParams.end()) return track->sample - params->second->offset;
+  }
+  return 0;
+}
+
+/* key for a source's separated stems, empty if it can't be cached */
+std::string separationKey(source* inSource){
+  if(!cache_enabled() || inSource->analysis == NULL || separator_backend() == NULL) return "";
+  return separation_key(inSource->analysis->hash, inSource->format, inSource->length);
+}
+
+/* stems already separated for this content, shared if loaded or mapped from the cache */
+sourceBuffer* separationCached(std::string key){
+  std::string bufferKey = "separated:" + key;
+  if(state.buffers.find(bufferKey) != state.buffers.end()) return state.buffers[bufferKey];
+
+  std::vector<std::string> suffixes;
+  std::vector<cacheMapping*> mappings;
+  for(int j=0;j<SEPARATE_STEMS;j++){
+    cacheMapping* mapping = cache_map(cache_path(key + SEPARATE_SUFFIXES[j]));
+    if(mapping == NULL || mapping->channels.size() != (unsigned int)CHANNEL_COUNT){
+      if(mapping != NULL) cache_unmap(mapping);
+      for(unsigned int i=0;i<mappings.size();i++) cache_unmap(mappings[i]);
+      return NULL;
+    }
+    suffixes.push_back(SEPARATE_SUFFIXES[j]);
+    mappings.push_back(mapping);
+  }
+  return newMappedBuffer(bufferKey, suffixes, mappings);
+}
+
+void noop(const Napi::CallbackInfo &info){}
+
+/* pool key for a source's separation, so js can cancel it without touching its loads */
+std::string separationJobKey(std::string sourceId){
+  return "separate:" + sourceId;
+}
+
+typedef struct{
+  float done;
+  int to;
+} separateProgress;
+
+/* stems are published as sources straight away and fill in from the playhead while the separation runs 
+as jobs on the engine pool. content separated before is mapped from the cache instead */
+class SeparateBatch {
   public:
-    SeparateWorker(
+    SeparateBatch(
       Napi::Env &env,
-      std::string sourceId
-    ): Napi::AsyncWorker(env),
-       deferred(Napi::Promise::Deferred::New(env)),
-       sourceId(sourceId){}
+      std::string sourceId,
+      int from,
+      Napi::Function onProgress
+    ): deferred(Napi::Promise::Deferred::New(env)),
+       sourceId(sourceId),
+       marks(NULL),
+       work(NULL),
+       cached(NULL),
+       result(false){
+      tsfn = Napi::ThreadSafeFunction::New(env, onProgress, "separateSource", 0, 1);
+      pool_cancel(separationJobKey(sourceId)); //newest request wins
+      inSource = state.sources.count(sourceId) ? state.sources[sourceId] : NULL;
+      if(inSource == NULL) return;
+      inSource->readers++;
+      if(separator_backend() == NULL){
+        std::cout << "can't separate " << sourceId << " without a model" << std::endl;
+        return;
+      }
 
-    ~SeparateWorker() {}
-    void Execute() { 
-      int sourceLen = state.sources[sourceId]->length;
-      for(uint32_t i=0;i<(uint32_t)CHANNEL_COUNT;i++){
-        for(int j=0;j<2;j++){
-          float* outBuff = new float[sourceLen];
-          outChannels.push_back(outBuff);
+      /* stems of an earlier separation may still be written by its jobs, they go away once those stop */
+      for(int j=0;j<SEPARATE_STEMS;j++) retireSource(sourceId + SEPARATE_SUFFIXES[j]);
+
+      key = separationKey(inSource);
+      cached = key.size() ? separationCached(key) : NULL;
+      if(cached != NULL){
+        if(REPSYS_LOG) std::cout << "separation cached " << key << std::endl;
+        addBufferSources(env, sourceId, cached);
+        for(int j=0;j<SEPARATE_STEMS;j++){
+          source* stem = state.sources[sourceId + SEPARATE_SUFFIXES[j]];
+          stem->readers++;
+          stems.push_back(stem);
         }
+        return;
       }
 
-      separate(state.sources[sourceId]->channels, outChannels, sourceLen);
-    }
-    void OnOK() {
-      Napi::Env env = Env();
-      Napi::HandleScope scope(env);
-
-      int sourceLen = state.sources[sourceId]->length;
-      for(int j=0;j<2;j++){
-        std::string sourceTrackId = sourceId + (j > 0?"_instru":"_vocal");
+      int sourceLen = inSource->length;
+      marks = separation_new(sourceLen, from);
+      for(int j=0;j<SEPARATE_STEMS;j++){
         source * newSource = new source{};
         newSource->length = sourceLen;
+        newSource->format = SAMPLE_FLOAT32;
+        newSource->buffer = NULL;
+        newSource->analysis = NULL;
+        newSource->separating = marks;
         newSource->removed = false;
         newSource->safe = false;
-        newSource->data = NULL;
-
-        for(unsigned int i=0;i<(unsigned int)CHANNEL_COUNT;i++){
-          newSource->channels.push_back(outChannels[j*2 + i]);
+        newSource->readers = 1; //written to until the separation is done
+        for(int i=0;i<CHANNEL_COUNT;i++){
+          float* channel = new float[sourceLen]();
+          newSource->channels.push_back(channel);
+          outChannels.push_back(channel);
         }
-        state.sources[sourceTrackId] = newSource;
+        stems.push_back(newSource);
+        state.sources[sourceId + SEPARATE_SUFFIXES[j]] = newSource;
       }
-
-      deferred.Resolve(Napi::Boolean::New(env, true));
+      marks->refs = SEPARATE_STEMS;
+      /* segments are read from the source as they're needed, compact formats included */
+      work = separation_work_new(inSource->channels, inSource->format, outChannels, sourceLen, marks);
     }
-    void OnError(Napi::Error const &error) {
-      deferred.Reject(error.Value());
+
+    void Queue(){
+      unsigned int lanes = work != NULL ? separation_lanes(work, pool_size()) : 1;
+      lanesLeft = lanes;
+      for(unsigned int i=0;i<lanes;i++) pool_queue(separationJobKey(sourceId), 1, [this](poolJob* job){
+        if(work != NULL) separation_run(work, [this](float done, int to){
+          /* progress is best effort, dropped if js is behind */
+          separateProgress* progress = new separateProgress{done, to};
+          napi_status status = tsfn.NonBlockingCall(progress, 
+            [](Napi::Env env, Napi::Function onProgress, separateProgress* progress){
+              if(env == nullptr){
+                delete progress;
+                return;
+              }
+              onProgress.Call({Napi::Number::New(env, progress->done), Napi::Number::New(env, progress->to)});
+              delete progress;
+            }
+          );
+          if(status != napi_ok) delete progress;
+        }, &job->cancelled);
+        if(--lanesLeft == 0) Complete();
+      });
     }
+
     Napi::Promise GetPromise() {
       return deferred.Promise();
     }
   private:
+    /* on the last job to finish, the stems are final by now */
+    void Complete(){
+      int sourceLen = inSource != NULL ? inSource->length : 0;
+      if(cached != NULL){
+        for(int j=0;j<SEPARATE_STEMS;j++) outAnalyses.push_back(cached->analyses[j] == NULL ?
+          analysis_run(cached->streams[j], SAMPLE_FLOAT32, cached->lengths[j]) : NULL);
+        result = true;
+      }else if(work != NULL && separation_complete(work)){
+        for(int j=0;j<SEPARATE_STEMS;j++){
+          std::vector<void*> stem(outChannels.begin() + j*CHANNEL_COUNT, outChannels.begin() + (j+1)*CHANNEL_COUNT);
+          outAnalyses.push_back(analysis_run(stem, SAMPLE_FLOAT32, sourceLen));
+        }
+
+        /* raw planar pcm, so the next separation of this content maps it back bit exact */
+        if(key.size()) for(int j=0;j<SEPARATE_STEMS;j++){
+          std::vector<float*> stem(outChannels.begin() + j*CHANNEL_COUNT, outChannels.begin() + (j+1)*CHANNEL_COUNT);
+          cache_write(key + SEPARATE_SUFFIXES[j], stem, sourceLen);
+        }
+        result = true;
+      }
+      tsfn.BlockingCall(this, [](Napi::Env env, Napi::Function onProgress, SeparateBatch* batch){
+        if(env == nullptr){ //torn down, there's no promise left to settle
+          if(batch->work != NULL) separation_work_delete(batch->work);
+          delete batch;
+          return;
+        }
+        batch->OnSeparated(env);
+      });
+    }
+
+    void OnSeparated(Napi::Env env){
+      Napi::HandleScope scope(env);
+      if(inSource != NULL) inSource->readers--;
+      for(unsigned int j=0;j<stems.size();j++){
+        stems[j]->readers--;
+        if(!result) stems[j]->removed = true; //partial stems go away with the separation
+      }
+      for(unsigned int j=0;j<outAnalyses.size();j++){
+        if(outAnalyses[j] == NULL) continue;
+        if(cached != NULL){
+          /* shared buffer, another separation may have analyzed it first */
+          if(cached->analyses[j] != NULL) analysis_delete(outAnalyses[j]);
+          else cached->analyses[j] = outAnalyses[j];
+          stems[j]->analysis = cached->analyses[j];
+        }else stems[j]->analysis = outAnalyses[j];
+      }
+      if(work != NULL) separation_work_delete(work);
+      deferred.Resolve(Napi::Boolean::New(env, result));
+      tsfn.Release();
+      delete this;
+    }
+
     Napi::Promise::Deferred deferred;
+    Napi::ThreadSafeFunction tsfn;
     std::string sourceId;
+    source* inSource;
+    separationMarks* marks;
+    separationWork* work;
+    std::string key;
+    sourceBuffer* cached;
+    std::atomic<unsigned int> lanesLeft;
+    bool result;
+    std::vector<source*> stems;
     std::vector<float*> outChannels;
+    std::vector<sourceAnalysis*> outAnalyses;
 };
 
 Napi::Value separateSource(const Napi::CallbackInfo &info){
   Napi::Env env = info.Env();
   std::string sourceId = info[0].As<Napi::String>().Utf8Value();
+  Napi::Function onProgress = Napi::Function::New(env, noop);
+  int from = sourcePlayhead(sourceId);
+  if(info[1].IsObject()){
+    Napi::Object options = info[1].As<Napi::Object>();
+    if(options.Has("onProgress") && options.Get("onProgress").IsFunction())
+      onProgress = options.Get("onProgress").As<Napi::Function>();
+    if(options.Has("from")) from = options.Get("from").As<Napi::Number>().Int32Value();
+  }
 
-  SeparateWorker* separateWorker = new SeparateWorker(env, sourceId);
-  auto promise = separateWorker->GetPromise();
-  separateWorker->Queue();
+  SeparateBatch* separateBatch = new SeparateBatch(env, sourceId, from, onProgress);
+  auto promise = separateBatch->GetPromise();
+  separateBatch->Queue();
   return promise;
 }
 
+/* cache files a source's stems are kept in by suffix, only those written in full. null if it can't be cached */
+Napi::Value getSeparationCache(const Napi::CallbackInfo &info){
+  Napi::Env env = info.Env();
+  std::string sourceId = info[0].As<Napi::String>().Utf8Value();
+  auto sourcePair = state.sources.find(sourceId);
+  if(sourcePair == state.sources.end() || sourcePair->second == NULL) return env.Null();
+  std::string key = separationKey(sourcePair->second);
+  if(!key.size()) return env.Null();
+
+  Napi::Object paths = Napi::Object::New(env);
+  for(int j=0;j<SEPARATE_STEMS;j++)
+    if(cache_has(key + SEPARATE_SUFFIXES[j])) paths.Set(SEPARATE_SUFFIXES[j], cache_path(key + SEPARATE_SUFFIXES[j]));
+  return paths;
+}
+
+void cancelSeparate(const Napi::CallbackInfo &info){
+  std::string sourceId = info[0].As<Napi::String>().Utf8Value();
+  if(REPSYS_LOG) std::cout << "cancel separate " << sourceId << std::endl;
+  pool_cancel(separationJobKey(sourceId));
+}
+
 void getWaveform(const Napi::CallbackInfo &info){
   //if(REPSYS_LOG) std::cout << "waveform" << std::endl;
   std::string sourceId = info[0].As<Napi::String>().Utf8Value();
@@ -528,97 +1489,447 @@ void getWaveform(const Napi::CallbackInfo &info){
 
   float* dest = reinterpret_cast<float*>(buff.ArrayBuffer().Data());
   int destLen = buff.ByteLength() / sizeof(float); //length of buffer (2x samples)
-  int samplesWidth = (destLen / 2) * scale; 
-  int startOffset;
-
-  if(sourceId == "_recording" && state.recording != NULL){ //recording monitor
-    recordChunk* chunk = state.recording->chunks[state.recording->chunkIndex];
-    float* source = chunk->channels[0];
-    int sourceLen = chunk->used;
-    startOffset = REC_CHUNK_SAMPLES * state.recording->chunkIndex;
-    minMaxWaveform(scale, start - startOffset, source, sourceLen, dest, destLen, false, 1);
-    
-    /* draw previous chunk if needed */
-    int prevLength = samplesWidth - sourceLen; //length of prev chunk visible
-    if(state.recording->chunkIndex > 0 && prevLength > 0){
-      chunk = state.recording->chunks[state.recording->chunkIndex - 1];
-      startOffset -= REC_CHUNK_SAMPLES; //once chunk back
-      minMaxWaveform(scale, start-startOffset,  chunk->channels[0], chunk->used, dest, destLen, true, 1);
-    }
+
+  if(sourceId == "_recording"){ //recording monitor, whole take at any zoom
+    std::lock_guard<std::mutex> lock(recordingLock);
+    recording* rec = state.recording;
+    if(rec == NULL) return;
+    std::vector<float*> chunks;
+    for(unsigned int chunkIndex=0;chunkIndex<rec->chunks.size();chunkIndex++)
+      chunks.push_back(rec->chunks[chunkIndex]->channels[0]);
+    chunkedPyramidWaveform(
+      rec->pyramid, scale, start, chunks, REC_CHUNK_SAMPLES, rec->pyramidLength, 
+      dest, destLen, NULL, false, 1
+    );
   }else if(state.sources.find(sourceId) != state.sources.end() && state.sources[sourceId] != NULL){
-    float* source = state.sources[sourceId]->channels[0];
-    int sourceLen = state.sources[sourceId]->length;
-    minMaxWaveform(scale, start, source, sourceLen, dest, destLen, false, 0.75);
+    source* waveSource = state.sources[sourceId];
+    /* an rms array too short for every pixel is left alone */
+    float* rmsDest = info[4].IsTypedArray() && info[4].As<Napi::Float32Array>().ElementLength() >= (size_t)destLen / 2 ?
+      info[4].As<Napi::Float32Array>().Data() : NULL;
+
+    if(waveSource->analysis != NULL) pyramidWaveform(
+      waveSource->analysis->pyramid, scale, start, waveSource->channels[0], waveSource->format, 
+      waveSource->length, dest, destLen, rmsDest, false, 0.75
+    );
+    else minMaxWaveform(scale, start, waveSource->channels[0], waveSource->format, waveSource->length, dest, destLen, false, 0.75);
   }
 }
 
-Napi::Value getImpulses(const Napi::CallbackInfo &info){
-  if(REPSYS_LOG) std::cout << "impulses" << std::endl;
+typedef struct{
+  source* source;
+  int start;
+  float scale;
+  float* dest;
+  int destLen;
+  float* rmsDest;
+  float* bandsDest;
+  int bandsDestLen;
+} waveformRequest;
+
+class WaveformWorker : public Napi::AsyncWorker {
+  public:
+    WaveformWorker(
+      Napi::Env &env
+    ): Napi::AsyncWorker(env),
+       deferred(Napi::Promise::Deferred::New(env)){}
+
+    ~WaveformWorker() {}
+    void Add(
+      source* waveSource, int start, float scale, Napi::Float32Array dest, Napi::Value rmsDest, Napi::Value bandsDest
+    ){
+      waveformRequest request;
+      request.source = waveSource;
+      request.start = start;
+      request.scale = scale;
+      request.dest = dest.Data();
+      request.destLen = dest.ElementLength();
+      request.rmsDest = NULL;
+      /* rms gets one value per pixel, destLen/2, a shorter array is skipped */
+      if(rmsDest.IsTypedArray() && rmsDest.As<Napi::Float32Array>().ElementLength() >= (size_t)request.destLen / 2){
+        Napi::Float32Array rmsArray = rmsDest.As<Napi::Float32Array>();
+        request.rmsDest = rmsArray.Data();
+        targets.push_back(Napi::Persistent(rmsArray));
+      }
+      request.bandsDest = NULL;
+      request.bandsDestLen = 0;
+      if(bandsDest.IsTypedArray()){
+        Napi::Float32Array bandsArray = bandsDest.As<Napi::Float32Array>();
+        request.bandsDest = bandsArray.Data();
+        request.bandsDestLen = bandsArray.ElementLength();
+        targets.push_back(Napi::Persistent(bandsArray));
+      }
+      targets.push_back(Napi::Persistent(dest));
+      waveSource->readers++;
+      requests.push_back(request);
+    }
+    void Execute() { 
+      /* requests are spread over the engine pool, ahead of loads since the ui is waiting on them */
+      pool_batch("waveforms", 1, requests.size(), [this](unsigned int i){
+        waveformRequest& request = requests[i];
+        source* waveSource = request.source;
+        if(waveSource->analysis != NULL) pyramidWaveform(
+          waveSource->analysis->pyramid, request.scale, request.start, waveSource->channels[0], waveSource->format, 
+          waveSource->length, request.dest, request.destLen, request.rmsDest, false, 0.75
+        );
+        else minMaxWaveform(
+          request.scale, request.start, waveSource->channels[0], waveSource->format, 
+          waveSource->length, request.dest, request.destLen, false, 0.75
+        );
+        if(request.bandsDest != NULL && waveSource->analysis != NULL) spectrumWaveform(
+          waveSource->analysis->spectrum, request.scale, request.start, waveSource->length, 
+          request.bandsDest, request.bandsDestLen, 0.75
+        );
+      });
+    }
+    void OnOK() {
+      Napi::Env env = Env();
+      Napi::HandleScope scope(env);
+      release();
+      deferred.Resolve(Napi::Boolean::New(env, true));
+    }
+    void OnError(Napi::Error const &error) {
+      release();
+      deferred.Reject(error.Value());
+    }
+    Napi::Promise GetPromise() {
+      return deferred.Promise();
+    }
+  private:
+    void release(){
+      for(unsigned int i=0;i<requests.size();i++) requests[i].source->readers--;
+      for(unsigned int i=0;i<targets.size();i++) targets[i].Reset();
+    }
+    Napi::Promise::Deferred deferred;
+    std::vector<waveformRequest> requests;
+    std::vector<Napi::ObjectReference> targets;
+};
+
+/* fill many waveforms off the js thread, resolves once all are written */
+Napi::Value getWaveforms(const Napi::CallbackInfo &info){
   Napi::Env env = info.Env();
-  std::string sourceId = info[0].As<Napi::String>().Utf8Value();
-  Napi::Array result = Napi::Array::New(env);
+  Napi::Array items = info[0].As<Napi::Array>();
+  WaveformWorker* waveformWorker = new WaveformWorker(env);
+
+  for(uint32_t i=0;i<items.Length();i++){
+    Napi::Object item = items.Get(i).As<Napi::Object>();
+    std::string sourceId = item.Get("sourceId").As<Napi::String>().Utf8Value();
+    auto sourcePair = state.sources.find(sourceId);
+    if(sourcePair == state.sources.end() || sourcePair->second == NULL) continue;
+    waveformWorker->Add(
+      sourcePair->second,
+      item.Get("start").As<Napi::Number>().Int32Value(),
+      item.Get("scale").As<Napi::Number>().FloatValue(),
+      item.Get("dest").As<Napi::Float32Array>(),
+      item.Get("rmsDest"),
+      item.Get("bandsDest")
+    );
+  }
 
-  if(state.sources.find(sourceId) != state.sources.end() && state.sources[sourceId] != NULL){
-    float* source = state.sources[sourceId]->channels[0];
-    int sourceLen = state.sources[sourceId]->length;
+  auto promise = waveformWorker->GetPromise();
+  waveformWorker->Queue();
+  return promise;
+}
 
-    std::vector<int> beats = impulseDetect(source, sourceLen);
+/* low/mid/high amplitudes per pixel, interleaved */
+void getBandWaveform(const Napi::CallbackInfo &info){
+  std::string sourceId = info[0].As<Napi::String>().Utf8Value();
+  int start = info[1].As<Napi::Number>().Int32Value();
+  float scale = info[2].As<Napi::Number>().FloatValue();
+  Napi::Float32Array dest = info[3].As<Napi::Float32Array>();
 
-    for(uint32_t beatIndex = 0;beatIndex<beats.size();beatIndex++)
-      result.Set(beatIndex, beats[beatIndex]);
-  }
-  
+  auto sourcePair = state.sources.find(sourceId);
+  if(sourcePair == state.sources.end() || sourcePair->second == NULL) return;
+  source* waveSource = sourcePair->second;
+  if(waveSource->analysis != NULL) spectrumWaveform(
+    waveSource->analysis->spectrum, scale, start, waveSource->length, dest.Data(), dest.ElementLength(), 0.75
+  );
+}
+
+/* loudness and peak from load analysis, null if the source has none */
+Napi::Value getAnalysis(const Napi::CallbackInfo &info){
+  Napi::Env env = info.Env();
+  std::string sourceId = info[0].As<Napi::String>().Utf8Value();
+  auto sourcePair = state.sources.find(sourceId);
+  if(sourcePair == state.sources.end() || sourcePair->second == NULL || sourcePair->second->analysis == NULL)
+    return env.Null();
+
+  sourceAnalysis* analysis = sourcePair->second->analysis;
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("loudness", analysis->loudness);
+  result.Set("peak", analysis->peak);
   return result;
 }
 
-class LoadWorker : public Napi::AsyncWorker {
+class ImpulseWorker : public Napi::AsyncWorker {
   public:
-    LoadWorker(
+    ImpulseWorker(
       Napi::Env &env,
-      std::string path,
-      std::string sourceId
+      source* impSource
     ): Napi::AsyncWorker(env),
        deferred(Napi::Promise::Deferred::New(env)),
-       path(path),
-       sourceId(sourceId){}
+       impSource(impSource){
+      if(impSource != NULL) impSource->readers++;
+    }
 
-    ~LoadWorker() {}
+    ~ImpulseWorker() {}
     void Execute() { 
-      loadSrc(path, sourceId, loadResponses);
+      if(impSource == NULL) return;
+      if(impSource->analysis != NULL && impSource->analysis->onsets.size()){
+        beats = impulseDetectEnergies(impSource->analysis->onsets, impSource->length);
+        return;
+      }
+      beats = impulseDetect(impSource->channels[0], impSource->format, impSource->length, "impulses");
     }
     void OnOK() {
       Napi::Env env = Env();
       Napi::HandleScope scope(env);
+      if(impSource != NULL) impSource->readers--;
 
-      Napi::Array loadedSources = Napi::Array::New(env);
-      loadResponse * res;
-      for(unsigned int i=0;i<loadResponses.size();i++){
-        res = loadResponses[i];
-        source * newSource = new source{};
-        newSource->length = res->length;
-        newSource->removed = false;
-        newSource->safe = false;
-        newSource->data = res->data;
-        for(unsigned int i=0;i<res->channels.size();i++){
-          newSource->channels.push_back(res->channels[i]);
+      Napi::Array result = Napi::Array::New(env);
+      for(uint32_t beatIndex = 0;beatIndex<beats.size();beatIndex++)
+        result.Set(beatIndex, beats[beatIndex]);
+      deferred.Resolve(result);
+    }
+    void OnError(Napi::Error const &error) {
+      if(impSource != NULL) impSource->readers--;
+      deferred.Reject(error.Value());
+    }
+    Napi::Promise GetPromise() {
+      return deferred.Promise();
+    }
+  private:
+    Napi::Promise::Deferred deferred;
+    source* impSource;
+    std::vector<int> beats;
+};
+
+class TempoWorker : public Napi::AsyncWorker {
+  public:
+    TempoWorker(
+      Napi::Env &env,
+      std::vector<source*> tempoSources
+    ): Napi::AsyncWorker(env),
+       deferred(Napi::Promise::Deferred::New(env)),
+       tempoSources(tempoSources){
+      for(unsigned int i=0;i<tempoSources.size();i++)
+        if(tempoSources[i] != NULL) tempoSources[i]->readers++;
+    }
+
+    ~TempoWorker() {}
+    void Execute() { 
+      /* one source per pool job, a library batch keeps the pool busy */
+      estimates.resize(tempoSources.size());
+      pool_batch("tempo", 0, tempoSources.size(), [this](unsigned int i){
+        source* tempoSource = tempoSources[i];
+        if(tempoSource != NULL) 
+          estimates[i] = tempoDetect(tempoSource->channels[0], tempoSource->format, tempoSource->length);
+      });
+    }
+    void OnOK() {
+      Napi::Env env = Env();
+      Napi::HandleScope scope(env);
+      release();
+
+      Napi::Array result = Napi::Array::New(env);
+      for(uint32_t i=0;i<tempoSources.size();i++){
+        if(tempoSources[i] == NULL || estimates[i].bpm == 0){
+          result.Set(i, env.Null());
+          continue;
         }
-        state.sources[res->sourceId] = newSource;
-        loadedSources.Set(i, res->sourceId);
+        Napi::Object estimate = Napi::Object::New(env);
+        estimate.Set("bpm", estimates[i].bpm);
+        estimate.Set("period", estimates[i].period);
+        estimate.Set("offset", estimates[i].offset);
+        estimate.Set("confidence", estimates[i].confidence);
+        result.Set(i, estimate);
       }
-
-      deferred.Resolve(loadedSources);
+      deferred.Resolve(result);
     }
     void OnError(Napi::Error const &error) {
+      release();
       deferred.Reject(error.Value());
     }
     Napi::Promise GetPromise() {
       return deferred.Promise();
     }
   private:
+    void release(){
+      for(unsigned int i=0;i<tempoSources.size();i++)
+        if(tempoSources[i] != NULL) tempoSources[i]->readers--;
+    }
     Napi::Promise::Deferred deferred;
-    std::string path;
-    std::string sourceId;
-    std::vector<loadResponse *> loadResponses; 
+    std::vector<source*> tempoSources;
+    std::vector<tempoEstimate> estimates;
+};
+
+/* tempo and beat grid for each source id, null where there's no estimate */
+Napi::Value getTempo(const Napi::CallbackInfo &info){
+  Napi::Env env = info.Env();
+  Napi::Array sourceIds = info[0].As<Napi::Array>();
+  std::vector<source*> tempoSources;
+  for(uint32_t i=0;i<sourceIds.Length();i++){
+    std::string sourceId = sourceIds.Get(i).As<Napi::String>().Utf8Value();
+    auto sourcePair = state.sources.find(sourceId);
+    tempoSources.push_back(sourcePair != state.sources.end() ? sourcePair->second : NULL);
+  }
+
+  TempoWorker* tempoWorker = new TempoWorker(env, tempoSources);
+  auto promise = tempoWorker->GetPromise();
+  tempoWorker->Queue();
+  return promise;
+}
+
+Napi::Value getImpulses(const Napi::CallbackInfo &info){
+  if(REPSYS_LOG) std::cout << "impulses" << std::endl;
+  Napi::Env env = info.Env();
+  std::string sourceId = info[0].As<Napi::String>().Utf8Value();
+
+  source* impSource = NULL;
+  auto sourcePair = state.sources.find(sourceId);
+  if(sourcePair != state.sources.end()) impSource = sourcePair->second;
+
+  ImpulseWorker* impulseWorker = new ImpulseWorker(env, impSource);
+  auto promise = impulseWorker->GetPromise();
+  impulseWorker->Queue();
+  return promise;
+}
+
+typedef struct{
+  std::string path;
+  std::string sourceId;
+  std::string key;
+  sourceBuffer* buffer;
+  bool cancelled;
+  std::vector<loadResponse *> loadResponses;
+  cacheMapping* mapping; //cache files are mapped rather than decoded
+  sourceAnalysis* mappingAnalysis;
+} loadItem;
+
+/* pool key for a source's load */
+std::string loadJobKey(std::string sourceId){
+  return "load:" + sourceId;
+}
+
+/* loads queued and not yet back, by job key. js thread only, so cancelling loads leaves other jobs be */
+static std::map<std::string, int> loadJobs;
+
+/* a set of loads run on the engine pool, results stream back to js one item at a time */
+class LoadBatch {
+  public:
+    LoadBatch(
+      Napi::Env &env,
+      Napi::Function onLoaded,
+      unsigned int count,
+      bool single
+    ): deferred(Napi::Promise::Deferred::New(env)),
+       remaining(count),
+       single(single){
+      tsfn = Napi::ThreadSafeFunction::New(env, onLoaded, "loadSources", 0, 1);
+    }
+
+    void Queue(std::string path, std::string sourceId, int priority, int format){
+      std::string key = loadKey(path, format);
+
+      /* file is already decoded, hold a ref so it survives until we attach to it */
+      sourceBuffer* buffer = NULL;
+      if(key.size() && state.buffers.find(key) != state.buffers.end()){
+        buffer = state.buffers[key];
+        buffer->refs++;
+      }
+
+      loadJobs[loadJobKey(sourceId)]++;
+      pool_queue(loadJobKey(sourceId), priority, [this, path, sourceId, key, buffer, format](poolJob* job){
+        loadItem* item = new loadItem{};
+        item->path = path;
+        item->sourceId = sourceId;
+        item->key = key;
+        item->buffer = buffer;
+        if(buffer == NULL && cache_is_file(path)){
+          item->mapping = cache_map(path);
+          if(item->mapping != NULL && !job->cancelled)
+            item->mappingAnalysis = analysis_run(item->mapping->channels, SAMPLE_FLOAT32, item->mapping->length);
+        }else if(buffer == NULL) loadSrc(path, sourceId, item->loadResponses, format, &job->cancelled);
+        item->cancelled = job->cancelled;
+        tsfn.BlockingCall(item, [this](Napi::Env env, Napi::Function onLoaded, loadItem* item){
+          if(env == nullptr){
+            Discard(item);
+            delete item;
+            return;
+          }
+          OnLoaded(env, onLoaded, item);
+        });
+      });
+    }
+
+    Napi::Promise GetPromise() {
+      return deferred.Promise();
+    }
+  private:
+    /* frees whatever the job decoded or mapped */
+    void Discard(loadItem* item){
+      for(unsigned int i=0;i<item->loadResponses.size();i++){
+        for(unsigned int c=0;c<item->loadResponses[i]->channels.size();c++)
+          samples_delete(item->loadResponses[i]->channels[c], item->loadResponses[i]->format);
+        analysis_delete(item->loadResponses[i]->analysis);
+        delete item->loadResponses[i];
+      }
+      item->loadResponses.clear();
+      if(item->mapping != NULL) cache_unmap(item->mapping);
+      if(item->mappingAnalysis != NULL) analysis_delete(item->mappingAnalysis);
+      item->mapping = NULL;
+      item->mappingAnalysis = NULL;
+    }
+
+    void OnLoaded(Napi::Env env, Napi::Function onLoaded, loadItem* item){
+      Napi::HandleScope scope(env);
+      sourceBuffer* buffer = item->buffer;
+      if(--loadJobs[loadJobKey(item->sourceId)] <= 0) loadJobs.erase(loadJobKey(item->sourceId));
+
+      /* the same file finished decoding for another load in the meantime, share that one */
+      if(
+        buffer == NULL && item->key.size() && 
+        state.buffers.find(item->key) != state.buffers.end()
+      ){
+        buffer = state.buffers[item->key];
+        buffer->refs++;
+      }
+
+      /* a cancelled load may have already been replaced, don't touch its sources */
+      if(item->cancelled || buffer != NULL) Discard(item);
+
+      Napi::Array loadedSources = Napi::Array::New(env);
+      if(buffer != NULL){
+        if(!item->cancelled) loadedSources = addBufferSources(env, item->sourceId, buffer);
+        releaseBuffer(buffer); //drop the ref held while loading
+      }else if(item->mapping != NULL){
+        sourceBuffer* mapped = newMappedBuffer(item->key, std::vector<std::string>{""}, std::vector<cacheMapping*>{item->mapping});
+        mapped->analyses[0] = item->mappingAnalysis;
+        loadedSources = addBufferSources(env, item->sourceId, mapped);
+      }else if(item->loadResponses.size()){
+        loadedSources = addBufferSources(
+          env, item->sourceId, newBuffer(item->key, item->sourceId, item->loadResponses)
+        );
+      }
+
+      if(single) deferred.Resolve(loadedSources);
+      else onLoaded.Call({
+        Napi::String::New(env, item->sourceId),
+        loadedSources,
+        Napi::Boolean::New(env, item->cancelled)
+      });
+      delete item;
+
+      if(--remaining == 0){
+        if(!single) deferred.Resolve(env.Undefined());
+        tsfn.Release();
+        delete this;
+      }
+    }
+
+    Napi::Promise::Deferred deferred;
+    Napi::ThreadSafeFunction tsfn;
+    unsigned int remaining;
+    bool single;
 };
 
 Napi::Value loadSource(const Napi::CallbackInfo &info){
@@ -627,21 +1938,196 @@ Napi::Value loadSource(const Napi::CallbackInfo &info){
   std::string sourceId = info[1].As<Napi::String>().Utf8Value();
   if(REPSYS_LOG) std::cout << "load " << sourceId << std::endl;
 
-  LoadWorker* loadWorker = new LoadWorker(env, path, sourceId);
-  auto promise = loadWorker->GetPromise();
-  loadWorker->Queue();
+  LoadBatch* loadBatch = new LoadBatch(env, Napi::Function::New(env, noop), 1, true);
+  auto promise = loadBatch->GetPromise();
+  loadBatch->Queue(path, sourceId, 0, state.sourceFormat);
+  return promise;
+}
+
+Napi::Value loadSources(const Napi::CallbackInfo &info){
+  Napi::Env env = info.Env();
+  Napi::Array items = info[0].As<Napi::Array>();
+  Napi::Function onLoaded = info[1].IsFunction() ?
+    info[1].As<Napi::Function>() : Napi::Function::New(env, noop);
+  if(REPSYS_LOG) std::cout << "load batch " << items.Length() << std::endl;
+
+  if(items.Length() == 0){
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    deferred.Resolve(env.Undefined());
+    return deferred.Promise();
+  }
+
+  LoadBatch* loadBatch = new LoadBatch(env, onLoaded, items.Length(), false);
+  auto promise = loadBatch->GetPromise();
+  for(uint32_t i=0;i<items.Length();i++){
+    Napi::Object item = items.Get(i).As<Napi::Object>();
+    loadBatch->Queue(
+      item.Get("path").As<Napi::String>().Utf8Value(),
+      item.Get("sourceId").As<Napi::String>().Utf8Value(),
+      item.Has("priority") ? item.Get("priority").As<Napi::Number>().Int32Value() : 0,
+      item.Has("format") ?
+        samples_format(item.Get("format").As<Napi::String>().Utf8Value()) : state.sourceFormat
+    );
+  }
   return promise;
 }
 
+void cancelLoads(const Napi::CallbackInfo &info){
+  if(REPSYS_LOG) std::cout << "cancel loads" << std::endl;
+  if(info[0].IsArray()){
+    Napi::Array sourceIds = info[0].As<Napi::Array>();
+    for(uint32_t i=0;i<sourceIds.Length();i++)
+      pool_cancel(loadJobKey(sourceIds.Get(i).As<Napi::String>().Utf8Value()));
+  }else for(auto loadPair: loadJobs) pool_cancel(loadPair.first);
+}
+
+void setSourceFormat(const Napi::CallbackInfo &info){
+  state.sourceFormat = info[0].IsString() ? samples_format(info[0].As<Napi::String>().Utf8Value()) : SAMPLE_FLOAT32;
+}
+
+void setPoolSize(const Napi::CallbackInfo &info){
+  pool_resize(info[0].As<Napi::Number>().Uint32Value());
+}
+
+typedef struct{
+  std::string path;
+  float done;
+  bool result;
+  bool cancelled;
+} exportItem;
+
+/* a set of exports encoded side by side on the engine pool, keyed by output path so they can be cancelled */
+class ExportBatch {
+  public:
+    ExportBatch(
+      Napi::Env &env,
+      Napi::Function onProgress,
+      unsigned int count,
+      bool single
+    ): deferred(Napi::Promise::Deferred::New(env)),
+       results(Napi::Persistent(Napi::Array::New(env))),
+       remaining(count),
+       single(single){
+      tsfn = Napi::ThreadSafeFunction::New(env, onProgress, "exportSources", 0, 1);
+      /* the pool runs this many exports at once, their codec threads share out the cores */
+      unsigned int running = std::max(std::min(count, pool_size()), 1u);
+      threads = std::max(std::thread::hardware_concurrency() / running, 1u);
+    }
+
+    void Queue(unsigned int index, std::string path, source* expSource, int codec){
+      if(expSource != NULL) expSource->readers++;
+      pool_queue(path, 0, [this, index, path, expSource, codec](poolJob* job){
+        exportItem* item = new exportItem{path, 1, false, false};
+        if(expSource != NULL && !job->cancelled){
+          item->result = exportSrc(path, expSource, codec, [this, path](float done){
+            /* progress is best effort, dropped if js is behind */
+            exportItem* progress = new exportItem{path, done, false, false};
+            napi_status status = tsfn.NonBlockingCall(progress, 
+              [this](Napi::Env env, Napi::Function onProgress, exportItem* progress){
+                if(env == nullptr){
+                  delete progress;
+                  return;
+                }
+                /* single exports only report the fraction */
+                if(single) onProgress.Call({Napi::Number::New(env, progress->done)});
+                else onProgress.Call({Napi::String::New(env, progress->path), Napi::Number::New(env, progress->done)});
+                delete progress;
+              }
+            );
+            if(status != napi_ok) delete progress; //never queued, so never deleted by the call
+          }, &job->cancelled, threads);
+        }
+        item->cancelled = job->cancelled;
+        tsfn.BlockingCall(item, [this, index, expSource](Napi::Env env, Napi::Function onProgress, exportItem* item){
+          if(env == nullptr){
+            delete item;
+            return;
+          }
+          OnExported(env, index, expSource, item);
+        });
+      });
+    }
+
+    Napi::Promise GetPromise() {
+      return deferred.Promise();
+    }
+  private:
+    void OnExported(Napi::Env env, unsigned int index, source* expSource, exportItem* item){
+      Napi::HandleScope scope(env);
+      if(expSource != NULL) expSource->readers--;
+      results.Value().Set(index, Napi::Boolean::New(env, item->result && !item->cancelled));
+      delete item;
+
+      if(--remaining == 0){
+        if(single) deferred.Resolve(results.Value().Get((uint32_t)0));
+        else deferred.Resolve(results.Value());
+        tsfn.Release();
+        delete this;
+      }
+    }
+
+    Napi::Promise::Deferred deferred;
+    Napi::ObjectReference results;
+    Napi::ThreadSafeFunction tsfn;
+    unsigned int remaining;
+    unsigned int threads;
+    bool single;
+};
+
 Napi::Value exportSource(const Napi::CallbackInfo &info){
   if(REPSYS_LOG) std::cout << "export" << std::endl;
   Napi::Env env = info.Env();
   std::string path = info[0].As<Napi::String>().Utf8Value();
   std::string sourceId = info[1].As<Napi::String>().Utf8Value();
-  source* expSource = state.sources[sourceId];
+  source* expSource = state.sources.count(sourceId) ? state.sources[sourceId] : NULL;
+
+  int codec = EXPORT_AAC;
+  Napi::Function onProgress = Napi::Function::New(env, noop);
+  if(info[2].IsObject()){
+    Napi::Object options = info[2].As<Napi::Object>();
+    if(options.Has("codec")) codec = export_codec(options.Get("codec").As<Napi::String>().Utf8Value());
+    if(options.Has("onProgress") && options.Get("onProgress").IsFunction())
+      onProgress = options.Get("onProgress").As<Napi::Function>();
+  }
+
+  ExportBatch* exportBatch = new ExportBatch(env, onProgress, 1, true);
+  auto promise = exportBatch->GetPromise();
+  exportBatch->Queue(0, path, expSource, codec);
+  return promise;
+}
+
+Napi::Value exportSources(const Napi::CallbackInfo &info){
+  Napi::Env env = info.Env();
+  Napi::Array items = info[0].As<Napi::Array>();
+  Napi::Function onProgress = info[1].IsFunction() ?
+    info[1].As<Napi::Function>() : Napi::Function::New(env, noop);
+  if(REPSYS_LOG) std::cout << "export batch " << items.Length() << std::endl;
+
+  if(items.Length() == 0){
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    deferred.Resolve(Napi::Array::New(env));
+    return deferred.Promise();
+  }
+
+  ExportBatch* exportBatch = new ExportBatch(env, onProgress, items.Length(), false);
+  auto promise = exportBatch->GetPromise();
+  for(uint32_t i=0;i<items.Length();i++){
+    Napi::Object item = items.Get(i).As<Napi::Object>();
+    std::string sourceId = item.Get("sourceId").As<Napi::String>().Utf8Value();
+    exportBatch->Queue(
+      i,
+      item.Get("path").As<Napi::String>().Utf8Value(),
+      state.sources.count(sourceId) ? state.sources[sourceId] : NULL,
+      item.Has("codec") ? export_codec(item.Get("codec").As<Napi::String>().Utf8Value()) : EXPORT_AAC
+    );
+  }
+  return promise;
+}
 
-  bool result = exportSrc(path, expSource);
-  return Napi::Boolean::New(env, result);
+void cancelExport(const Napi::CallbackInfo &info){
+  std::string path = info[0].As<Napi::String>().Utf8Value();
+  if(REPSYS_LOG) std::cout << "cancel export " << path << std::endl;
+  pool_cancel(path);
 }
 
 void startRecording(const Napi::CallbackInfo &info){
@@ -658,11 +2144,56 @@ void startRecording(const Napi::CallbackInfo &info){
     newRecording->started = !newRecording->fromSource;
     newRecording->chunkIndex = 0;
     newRecording->length = 0;
+    newRecording->pyramid = pyramid_new(0);
+    newRecording->pyramidLength = 0;
     allocateChunk(newRecording);
+    std::lock_guard<std::mutex> lock(recordingLock);
     state.recording = newRecording;
   }
 }
 
+/* analyses a finished take on the pool and attaches it on the js thread. the take draws from its samples
+until then */
+class RecordingAnalysis {
+  public:
+    RecordingAnalysis(
+      Napi::Env env,
+      std::string sourceId,
+      source* recSource
+    ): sourceId(sourceId),
+       recSource(recSource){
+      tsfn = Napi::ThreadSafeFunction::New(env, Napi::Function::New(env, noop), "analyzeRecording", 0, 1);
+      recSource->readers++;
+    }
+
+    void Queue(){
+      pool_queue("analyze:" + sourceId, 0, [this](poolJob* job){
+        sourceAnalysis* analysis = analysis_run(recSource->channels, SAMPLE_FLOAT32, recSource->length);
+        napi_status status = tsfn.BlockingCall(analysis, [this](Napi::Env env, Napi::Function, sourceAnalysis* analysis){
+          if(env == nullptr){
+            analysis_delete(analysis);
+            return;
+          }
+          Attach(analysis);
+        });
+        if(status != napi_ok) analysis_delete(analysis);
+      });
+    }
+  private:
+    void Attach(sourceAnalysis* analysis){
+      recSource->readers--;
+      if(!recSource->removed) recSource->analysis = analysis;
+      else analysis_delete(analysis);
+      if(REPSYS_LOG) std::cout << "analyzed recording " << sourceId << std::endl;
+      tsfn.Release();
+      delete this;
+    }
+
+    Napi::ThreadSafeFunction tsfn;
+    std::string sourceId;
+    source* recSource;
+};
+
 Napi::Value stopRecording(const Napi::CallbackInfo &info){
   Napi::Env env = info.Env();
   std::string sourceId = info[0].As<Napi::String>().Utf8Value();
@@ -671,7 +2202,10 @@ Napi::Value stopRecording(const Napi::CallbackInfo &info){
   if(state.recording != NULL){
     if(REPSYS_LOG) std::cout << "stop rec" << std::endl;
     recording* rec = state.recording; // save reference to recording
-     state.recording = NULL; // immediately set to null so the callback won't record to it anymore
+    {
+      std::lock_guard<std::mutex> lock(recordingLock);
+      state.recording = NULL; // immediately set to null so the callback won't record to it anymore
+    }
 
     unsigned int offset = rec->fromSourceOffset;
     int recLength = offset + rec->length; //offset includes appended track
@@ -681,9 +2215,11 @@ Napi::Value stopRecording(const Napi::CallbackInfo &info){
     /* create new source to put recording into */
     source * newSource = new source{};
     newSource->length = recLength;
+    newSource->format = SAMPLE_FLOAT32;
+    newSource->buffer = NULL;
+    newSource->analysis = NULL;
     newSource->removed = false;
     newSource->safe = false;
-    newSource->data = NULL;
 
     unsigned int chunkIndex;
     unsigned int sampleIndex;
@@ -696,8 +2232,9 @@ Napi::Value stopRecording(const Napi::CallbackInfo &info){
       float* channel = new float[recLength];
 
       if(rec->fromSource){ //copy from starting source
-        for(sampleIndex=0;sampleIndex<offset;sampleIndex++)
-          channel[sampleIndex] = fromSource->channels[channelIndex][sampleIndex];
+        samples_read(
+          fromSource->channels[channelIndex], fromSource->format, fromSource->length, 0, offset, channel
+        );
       }
 
       sampleIndex = offset;
@@ -714,7 +2251,10 @@ Napi::Value stopRecording(const Napi::CallbackInfo &info){
       }
       newSource->channels.push_back(channel);
     }
+    /* the live pyramid skips the clamp and the prefix, so the final take is analyzed off the js thread */
+    pyramid_delete(rec->pyramid);
     state.sources[sourceId] = newSource;
+    (new RecordingAnalysis(env, sourceId, newSource))->Queue();
     
     /* copy bounds */
     int boundIndex = 0;
@@ -761,12 +2301,33 @@ void InitAudio(Napi::Env env, Napi::Object exports){
   exports.Set("removeSource", Napi::Function::New(env, removeSource));
   exports.Set("setMixTrack", Napi::Function::New(env, setMixTrack));
   exports.Set("removeMixTrack", Napi::Function::New(env, removeMixTrack));
+  exports.Set("setParams", Napi::Function::New(env, setParams));
+  exports.Set("automate", Napi::Function::New(env, automate));
+  exports.Set("clearAutomation", Napi::Function::New(env, clearAutomation));
+  exports.Set("freezeMixTrack", Napi::Function::New(env, freezeMixTrack));
+  exports.Set("unfreezeMixTrack", Napi::Function::New(env, unfreezeMixTrack));
   exports.Set("getTiming", Napi::Function::New(env, getTiming));
+  exports.Set("getTimingBuffer", Napi::Function::New(env, getTimingBuffer));
+  exports.Set("getTimingSlots", Napi::Function::New(env, getTimingSlots));
+  exports.Set("sweep", Napi::Function::New(env, sweepRemoved));
+  exports.Set("onEvents", Napi::Function::New(env, onEvents));
   exports.Set("separateSource", Napi::Function::New(env, separateSource));
+  exports.Set("cancelSeparate", Napi::Function::New(env, cancelSeparate));
+  exports.Set("getSeparationCache", Napi::Function::New(env, getSeparationCache));
   exports.Set("getWaveform", Napi::Function::New(env, getWaveform));
+  exports.Set("getWaveforms", Napi::Function::New(env, getWaveforms));
+  exports.Set("getBandWaveform", Napi::Function::New(env, getBandWaveform));
   exports.Set("getImpulses", Napi::Function::New(env, getImpulses));
+  exports.Set("getTempo", Napi::Function::New(env, getTempo));
+  exports.Set("getAnalysis", Napi::Function::New(env, getAnalysis));
   exports.Set("loadSource", Napi::Function::New(env, loadSource));
+  exports.Set("loadSources", Napi::Function::New(env, loadSources));
+  exports.Set("cancelLoads", Napi::Function::New(env, cancelLoads));
+  exports.Set("setPoolSize", Napi::Function::New(env, setPoolSize));
+  exports.Set("setSourceFormat", Napi::Function::New(env, setSourceFormat));
   exports.Set("exportSource", Napi::Function::New(env, exportSource));
+  exports.Set("exportSources", Napi::Function::New(env, exportSources));
+  exports.Set("cancelExport", Napi::Function::New(env, cancelExport));
   exports.Set("startRecording", Napi::Function::New(env, startRecording));
   exports.Set("stopRecording", Napi::Function::New(env, stopRecording));
   exports.Set("syncToTrack", Napi::Function::New(env, syncToTrack));
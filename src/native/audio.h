@@ -11,8 +11,11 @@
 #include "load.h"
 #include "export.h"
 #include "impdet.h"
+#include "tempo.h"
 #include "waveform.h"
 #include "recording.h"
+#include "pool.h"
+#include "params.h"
 
 Napi::Value init(const Napi::CallbackInfo &info);
 Napi::Value getOutputs(const Napi::CallbackInfo &info);
@@ -25,13 +28,37 @@ void updatePlayback(const Napi::CallbackInfo &info);
 void updateTime(const Napi::CallbackInfo &info);
 Napi::Value removeSource(const Napi::CallbackInfo &info);
 void setMixTrack(const Napi::CallbackInfo &info);
+void setParams(const Napi::CallbackInfo &info);
+Napi::Value automate(const Napi::CallbackInfo &info);
+void clearAutomation(const Napi::CallbackInfo &info);
+Napi::Value freezeMixTrack(const Napi::CallbackInfo &info);
+Napi::Value unfreezeMixTrack(const Napi::CallbackInfo &info);
 Napi::Value removeMixTrack(const Napi::CallbackInfo &info);
 Napi::Value getTiming(const Napi::CallbackInfo &info);
+Napi::Value getTimingBuffer(const Napi::CallbackInfo &info);
+Napi::Value getTimingSlots(const Napi::CallbackInfo &info);
+void sweepRemoved(const Napi::CallbackInfo &info);
+void onEvents(const Napi::CallbackInfo &info);
+
+/* free removed sources and tracks once they're safe */
+void sweep();
 Napi::Value separateSource(const Napi::CallbackInfo &info);
+void cancelSeparate(const Napi::CallbackInfo &info);
+Napi::Value getSeparationCache(const Napi::CallbackInfo &info);
 void getWaveform(const Napi::CallbackInfo &info);
+Napi::Value getWaveforms(const Napi::CallbackInfo &info);
+void getBandWaveform(const Napi::CallbackInfo &info);
 Napi::Value getImpulses(const Napi::CallbackInfo &info);
+Napi::Value getTempo(const Napi::CallbackInfo &info);
+Napi::Value getAnalysis(const Napi::CallbackInfo &info);
 Napi::Value loadSource(const Napi::CallbackInfo &info);
+Napi::Value loadSources(const Napi::CallbackInfo &info);
+void cancelLoads(const Napi::CallbackInfo &info);
+void setPoolSize(const Napi::CallbackInfo &info);
+void setSourceFormat(const Napi::CallbackInfo &info);
 Napi::Value exportSource(const Napi::CallbackInfo &info);
+Napi::Value exportSources(const Napi::CallbackInfo &info);
+void cancelExport(const Napi::CallbackInfo &info);
 void startRecording(const Napi::CallbackInfo &info);
 Napi::Value stopRecording(const Napi::CallbackInfo &info);
 void syncToTrack(const Napi::CallbackInfo &info);
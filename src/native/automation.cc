@@ -0,0 +1,150 @@
+#include "automation.h"
+
+trackAutomation* automation_new(){
+  trackAutomation* a = new trackAutomation{};
+  a->head = 0;
+  a->tail = 0;
+  return a;
+}
+
+void automation_delete(trackAutomation* a){
+  delete a;
+}
+
+bool automation_push(trackAutomation* a, automationPoint point){
+  unsigned int h = a->head.load(std::memory_order_relaxed);
+  if(h - a->tail.load(std::memory_order_acquire) >= (unsigned int)AUTOMATION_SIZE) return false;
+  a->incoming[h % AUTOMATION_SIZE] = point;
+  a->head.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+/* insert keeping frame order, after any points at the same frame */
+bool automation_insert(trackAutomation* a, automationPoint point){
+  int param = point.param;
+  automationPoint* points = a->points[param];
+  int& count = a->counts[param];
+  if(count >= AUTOMATION_SIZE) return false;
+  int index = count;
+  while(index > 0 && points[index-1].frame > point.frame){
+    points[index] = points[index-1];
+    index--;
+  }
+  points[index] = point;
+  count++;
+  return true;
+}
+
+void automation_begin(trackAutomation* a, double frame, double time, double period, double* current){
+  /* the period may have changed since last buffer, phase points move with it */
+  for(int param=0;param<AUTOMATION_PARAMS;param++){
+    automationPoint* points = a->points[param];
+    bool moved = false;
+    for(int i=0;i<a->counts[param];i++){
+      if(!points[i].phase) continue;
+      points[i].frame = frame + (points[i].at - time) * period;
+      moved = true;
+    }
+    if(!moved) continue;
+    /* in place and stable, the audio thread can't allocate. points are nearly sorted already */
+    for(int i=1;i<a->counts[param];i++){
+      automationPoint point = points[i];
+      int index = i;
+      while(index > 0 && points[index-1].frame > point.frame){
+        points[index] = points[index-1];
+        index--;
+      }
+      points[index] = point;
+    }
+  }
+
+  unsigned int t = a->tail.load(std::memory_order_relaxed);
+  unsigned int h = a->head.load(std::memory_order_acquire);
+  for(;t != h;t++){
+    automationPoint point = a->incoming[t % AUTOMATION_SIZE];
+    if(point.param == AUTOMATE_CLEAR){
+      for(int param=0;param<AUTOMATION_PARAMS;param++)
+        if(point.value < 0 || (int)point.value == param) a->counts[param] = 0;
+      continue;
+    }
+    if(point.param < 0 || point.param >= AUTOMATION_PARAMS) continue;
+    point.frame = point.phase ? frame + (point.at - time) * period : point.at;
+    /* a ramp needs somewhere to start, if nothing comes before it that's now */
+    if(point.ramp && (a->counts[point.param] == 0 || a->points[point.param][0].frame > point.frame)){
+      automationPoint anchor{};
+      anchor.param = point.param;
+      anchor.at = frame;
+      anchor.frame = frame;
+      anchor.value = current[point.param];
+      automation_insert(a, anchor);
+    }
+    automation_insert(a, point);
+  }
+  a->tail.store(t, std::memory_order_release);
+}
+
+bool automation_active(trackAutomation* a, int param, double frame){
+  return a->counts[param] > 0 && a->points[param][0].frame < frame;
+}
+
+double automation_value(trackAutomation* a, int param, double frame, double current){
+  automationPoint* points = a->points[param];
+  int count = a->counts[param];
+  int next = 0;
+  while(next < count && points[next].frame <= frame) next++;
+  if(next == 0) return current;
+  automationPoint& from = points[next-1];
+  if(next < count && points[next].ramp){
+    automationPoint& to = points[next];
+    double position = (frame - from.frame) / (to.frame - from.frame);
+    return from.value + (to.value - from.value) * position;
+  }
+  return from.value;
+}
+
+void automation_render(trackAutomation* a, int param, double frame, int count, double current, float* out){
+  automationPoint* points = a->points[param];
+  int pointCount = a->counts[param];
+  int next = 0;
+  count = std::min(count, AUTOMATION_FRAMES);
+  for(int i=0;i<count;i++){
+    double at = frame + i;
+    /* walk the points along with the frames rather than searching for each */
+    while(next < pointCount && points[next].frame <= at) next++;
+    double value = current;
+    if(next > 0){
+      automationPoint& from = points[next-1];
+      value = from.value;
+      if(next < pointCount && points[next].ramp)
+        value += (points[next].value - from.value) * (at - from.frame) / (points[next].frame - from.frame);
+    }
+    out[i] *= value;
+  }
+}
+
+bool automation_end(trackAutomation* a, double frame, double* values, bool* changed){
+  bool anyChanged = false;
+  for(int param=0;param<AUTOMATION_PARAMS;param++){
+    automationPoint* points = a->points[param];
+    int count = a->counts[param];
+    int passed = 0;
+    while(passed < count && points[passed].frame <= frame) passed++;
+    changed[param] = passed > 0;
+    if(!passed) continue;
+    anyChanged = true;
+
+    values[param] = automation_value(a, param, frame, values[param]);
+    std::copy(points + passed, points + count, points);
+    a->counts[param] = count - passed;
+    /* a ramp still under way carries on from here */
+    if(a->counts[param] > 0 && points[0].ramp){
+      automationPoint anchor{};
+      anchor.param = param;
+      anchor.at = frame;
+      anchor.frame = frame;
+      anchor.value = values[param];
+      automation_insert(a, anchor);
+    }
+  }
+  return anyChanged;
+}
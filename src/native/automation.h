@@ -0,0 +1,66 @@
+#include <atomic>
+#include <algorithm>
+
+#include "constants.h"
+
+#ifndef AUTOMATION_HEADER_H
+#define AUTOMATION_HEADER_H
+
+/* per track parameter automation. js queues points without locks, the audio thread keeps them sorted in
+fixed arrays and evaluates them per frame, so nothing is allocated while playing */
+static const int AUTOMATION_SIZE = 64; //points per param, and queued at once. more are refused
+static const int AUTOMATION_PARAMS = 4;
+static int AUTOMATION_FRAMES = WINDOW_SIZE * 8; //per frame gain rendered for one buffer, later frames hold the last
+
+enum automationParam {
+  AUTOMATE_VOLUME,
+  AUTOMATE_FILTER,
+  AUTOMATE_ALPHA,
+  AUTOMATE_PLAYING
+};
+
+static const int AUTOMATE_CLEAR = -1; //queued as a param to drop points, value is the param or -1 for all
+
+typedef struct{
+  int param;
+  double at; //output frame, or transport time if phase
+  bool phase;
+  double value;
+  bool ramp; //reach value at at linearly from the point before, otherwise jump there
+  double frame; //at resolved to an output frame, audio thread only
+} automationPoint;
+
+typedef struct{
+  automationPoint incoming[AUTOMATION_SIZE];
+  std::atomic<unsigned int> head; //written by js
+  std::atomic<unsigned int> tail; //written by the audio thread
+  automationPoint points[AUTOMATION_PARAMS][AUTOMATION_SIZE]; //sorted by frame
+  int counts[AUTOMATION_PARAMS];
+} trackAutomation;
+
+trackAutomation* automation_new();
+
+void automation_delete(trackAutomation* a);
+
+/* js thread only, false if the queue is full */
+bool automation_push(trackAutomation* a, automationPoint point);
+
+/* audio thread, at the start of a buffer at output frame and transport time. takes queued points and
+places phase points for the current period. current is each param's value now, ramps with no point
+before them start from it */
+void automation_begin(trackAutomation* a, double frame, double time, double period, double* current);
+
+/* whether param has a point before frame, so it changes somewhere up to there */
+bool automation_active(trackAutomation* a, int param, double frame);
+
+/* param's value at frame, current if it isn't automated there */
+double automation_value(trackAutomation* a, int param, double frame, double current);
+
+/* param from frame for count frames, multiplied into out */
+void automation_render(trackAutomation* a, int param, double frame, int count, double current, float* out);
+
+/* audio thread, after a buffer ending at frame. drops points that passed and writes values for params
+that changed, returning whether any did */
+bool automation_end(trackAutomation* a, double frame, double* values, bool* changed);
+
+#endif
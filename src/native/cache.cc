@@ -0,0 +1,223 @@
+#include "cache.h"
+/* platform mapping apis stay out of the header, windows.h would leak its macros everywhere */
+#ifdef _WIN32
+  #define NOMINMAX
+  #include <windows.h>
+  #include <direct.h>
+  #include <sys/utime.h>
+#else
+  #include <sys/mman.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <dirent.h>
+  #include <utime.h>
+#endif
+
+static std::string cacheDir = "";
+static std::atomic<unsigned int> writeCount(0);
+static std::mutex trimLock;
+
+typedef struct{
+  std::string path;
+  uint64_t size;
+  int64_t used; //modified time, bumped whenever the file is mapped
+} cacheEntry;
+
+void cache_init(std::string dir){
+#ifdef _WIN32
+  _mkdir(dir.c_str());
+#else
+  mkdir(dir.c_str(), 0755);
+#endif
+  struct stat info;
+  if(stat(dir.c_str(), &info) == 0 && (info.st_mode & S_IFDIR)) cacheDir = dir;
+  else std::cout << "couldn't use cache dir " << dir << std::endl;
+}
+
+bool cache_enabled(){
+  return cacheDir.size() > 0;
+}
+
+std::string cache_path(std::string key){
+  return cacheDir + "/" + key + CACHE_EXTENSION;
+}
+
+bool cache_has(std::string key){
+  struct stat info;
+  return cache_enabled() && stat(cache_path(key).c_str(), &info) == 0;
+}
+
+bool cache_is_file(std::string path){
+  size_t extLen = strlen(CACHE_EXTENSION);
+  return path.size() > extLen && path.compare(path.size() - extLen, extLen, CACHE_EXTENSION) == 0;
+}
+
+/* rename over an existing file, which plain rename refuses on windows */
+bool cache_replace(std::string from, std::string to){
+#ifdef _WIN32
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+void cache_touch(std::string path){
+#ifdef _WIN32
+  _utime(path.c_str(), NULL);
+#else
+  utime(path.c_str(), NULL);
+#endif
+}
+
+/* every finished cache file, temporaries have their own extension */
+std::vector<cacheEntry> cache_list(){
+  std::vector<cacheEntry> entries;
+#ifdef _WIN32
+  WIN32_FIND_DATAA found;
+  HANDLE search = FindFirstFileA((cacheDir + "/*" + CACHE_EXTENSION).c_str(), &found);
+  if(search == INVALID_HANDLE_VALUE) return entries;
+  do{
+    if(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+    cacheEntry entry;
+    entry.path = cacheDir + "/" + found.cFileName;
+    entry.size = ((uint64_t)found.nFileSizeHigh << 32) | found.nFileSizeLow;
+    entry.used = ((int64_t)found.ftLastWriteTime.dwHighDateTime << 32) | found.ftLastWriteTime.dwLowDateTime;
+    entries.push_back(entry);
+  }while(FindNextFileA(search, &found));
+  FindClose(search);
+#else
+  DIR* dir = opendir(cacheDir.c_str());
+  if(dir == NULL) return entries;
+  struct dirent* item;
+  while((item = readdir(dir)) != NULL){
+    std::string path = cacheDir + "/" + item->d_name;
+    struct stat info;
+    if(!cache_is_file(path) || stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) continue;
+    entries.push_back(cacheEntry{path, (uint64_t)info.st_size, (int64_t)info.st_mtime});
+  }
+  closedir(dir);
+#endif
+  return entries;
+}
+
+/* drop the least recently used files until the cache fits, keep is never removed */
+void cache_trim(std::string keep){
+  std::lock_guard<std::mutex> guard(trimLock);
+  std::vector<cacheEntry> entries = cache_list();
+  uint64_t total = 0;
+  for(unsigned int i=0;i<entries.size();i++) total += entries[i].size;
+  if(total <= CACHE_MAX_SIZE) return;
+
+  std::sort(entries.begin(), entries.end(), [](const cacheEntry& a, const cacheEntry& b){ return a.used < b.used; });
+  for(unsigned int i=0;i<entries.size() && total > CACHE_MAX_SIZE;i++){
+    if(entries[i].path == keep) continue;
+    /* a file mapped on windows can't be removed yet, it's tried again next write */
+    if(remove(entries[i].path.c_str()) == 0){
+      if(REPSYS_LOG) std::cout << "cache evict " << entries[i].path << std::endl;
+      total -= entries[i].size;
+    }
+  }
+}
+
+bool cache_write(std::string key, std::vector<float*>& channels, int length){
+  if(!cache_enabled()) return false;
+  std::string path = cache_path(key);
+  /* unique, content separated twice at once writes twice */
+  std::string tempPath = path + "." + std::to_string(writeCount++) + ".tmp";
+
+  FILE* file = fopen(tempPath.c_str(), "wb");
+  if(file == NULL){
+    std::cout << "couldn't write cache " << tempPath << std::endl;
+    return false;
+  }
+
+  cacheHeader header{};
+  memcpy(header.magic, CACHE_MAGIC, 4);
+  header.version = CACHE_VERSION;
+  header.channels = channels.size();
+  header.length = length;
+  bool ok = fwrite(&header, sizeof(cacheHeader), 1, file) == 1;
+  for(unsigned int c=0;c<channels.size() && ok;c++)
+    ok = fwrite(channels[c], sizeof(float), length, file) == (size_t)length;
+  ok = fclose(file) == 0 && ok;
+
+  if(ok) ok = cache_replace(tempPath, path);
+  if(!ok){
+    std::cout << "failed writing cache " << path << std::endl;
+    remove(tempPath.c_str());
+  }else cache_trim(path);
+  return ok;
+}
+
+/* map the whole file read only, NULL if it can't be */
+void* cache_map_file(std::string path, size_t* size){
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(file == INVALID_HANDLE_VALUE) return NULL;
+  LARGE_INTEGER fileSize;
+  HANDLE view = NULL;
+  if(GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= (LONGLONG)sizeof(cacheHeader))
+    view = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if(view == NULL) return NULL;
+  void* data = MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(view); //the view keeps the mapping
+  *size = fileSize.QuadPart;
+  return data;
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0) return NULL;
+
+  struct stat info;
+  if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(cacheHeader)){
+    close(fd);
+    return NULL;
+  }
+
+  *size = info.st_size;
+  void* data = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); //the mapping keeps the file
+  if(data == MAP_FAILED) return NULL;
+  /* sources are read front to back, let the kernel get ahead */
+  madvise(data, *size, MADV_WILLNEED);
+  return data;
+#endif
+}
+
+void cache_unmap_file(void* data, size_t size){
+#ifdef _WIN32
+  UnmapViewOfFile(data);
+#else
+  munmap(data, size);
+#endif
+}
+
+cacheMapping* cache_map(std::string path){
+  size_t size = 0;
+  void* data = cache_map_file(path, &size);
+  if(data == NULL) return NULL;
+
+  cacheHeader* header = (cacheHeader*)data;
+  if(
+    memcmp(header->magic, CACHE_MAGIC, 4) != 0 || header->version != CACHE_VERSION ||
+    size != sizeof(cacheHeader) + (size_t)header->channels * header->length * sizeof(float)
+  ){
+    std::cout << "bad cache file " << path << std::endl;
+    cache_unmap_file(data, size);
+    return NULL;
+  }
+
+  cache_touch(path);
+  cacheMapping* mapping = new cacheMapping{};
+  mapping->data = data;
+  mapping->size = size;
+  mapping->length = header->length;
+  float* samples = (float*)((char*)data + sizeof(cacheHeader));
+  for(unsigned int c=0;c<header->channels;c++) mapping->channels.push_back(samples + (size_t)c * header->length);
+  return mapping;
+}
+
+void cache_unmap(cacheMapping* mapping){
+  cache_unmap_file(mapping->data, mapping->size);
+  delete mapping;
+}
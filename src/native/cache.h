@@ -0,0 +1,65 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <sys/stat.h>
+
+#include "constants.h"
+
+#ifndef CACHE_HEADER_H
+#define CACHE_HEADER_H
+
+static const char* CACHE_MAGIC = "RSPC";
+static uint32_t CACHE_VERSION = 1;
+static const char* CACHE_EXTENSION = ".rspcm";
+static uint64_t CACHE_MAX_SIZE = (uint64_t)4096 * 1024 * 1024; //least recently used files go past this
+
+/* raw planar float32 after a fixed header, padded so channels are aligned when mapped */
+typedef struct{
+  char magic[4];
+  uint32_t version;
+  uint32_t channels;
+  uint32_t length;
+  char padding[48];
+} cacheHeader;
+
+/* a cache file mapped read only, channels point into it */
+typedef struct{
+  void* data;
+  size_t size;
+  int length;
+  std::vector<void*> channels;
+} cacheMapping;
+
+/* directory for cache files, created if needed. caching is off until this is called */
+void cache_init(std::string dir);
+
+bool cache_enabled();
+
+/* path of the cache file for a key */
+std::string cache_path(std::string key);
+
+/* whether key's file has been written in full */
+bool cache_has(std::string key);
+
+/* whether path names a cache file rather than something to decode */
+bool cache_is_file(std::string path);
+
+/* also how finished exports replace their target */
+bool cache_replace(std::string from, std::string to);
+
+/* write channels of length to the cache under key, through a temporary so readers never see part of it.
+the least recently used files are removed to keep the cache under CACHE_MAX_SIZE */
+bool cache_write(std::string key, std::vector<float*>& channels, int length);
+
+/* map a cache file, NULL if it's missing or doesn't look right. marks it as used */
+cacheMapping* cache_map(std::string path);
+
+void cache_unmap(cacheMapping* mapping);
+
+#endif
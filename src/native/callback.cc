@@ -6,11 +6,249 @@ int getAvailable(ringbuffer* buffer){
   else return buffer->head + (buffer->size - buffer->tail);
 }
 
+/* offline renders run on a worker thread, the queue only takes the device callback's events */
+void pushEvent(streamState* state, int type, int slot, int value){
+  if(!state->offline) events_push(type, slot, value);
+}
+
 void applyNextPlayback(std::string mixTrackId, streamState* state){
   mixTrack* mixTrack = state->mixTracks[mixTrackId];
   mixTrack->playback = mixTrack->nextPlayback;
   mixTrack->nextPlayback = NULL;
   mixTrack->hasNext = false;
+  pushEvent(state, EVENT_NEXT, mixTrack->timingSlot, 0);
+}
+
+void setFilterCutoff(Dsp::Filter* filter, float cutoff){
+  Dsp::Params params;
+  params[0] = SAMPLE_RATE;
+  params[1] = SAMPLE_RATE/2 * cutoff; // cutoff frequency
+  params[2] = 1.25; // Q
+  filter->setParams(params);
+}
+
+void updateMixTrackFilter(mixTrack* mixTrack){
+  setFilterCutoff(mixTrack->filter, mixTrack->playback->filter);
+}
+
+/* the track's automatable params as they are, in automationParam order */
+void getAutomationValues(mixTrack* mixTrack, double* values){
+  values[AUTOMATE_VOLUME] = mixTrack->playback->volume;
+  values[AUTOMATE_FILTER] = mixTrack->playback->filter;
+  values[AUTOMATE_ALPHA] = mixTrack->playback->alpha;
+  values[AUTOMATE_PLAYING] = mixTrack->playback->playing;
+}
+
+/* the track plays its frozen render, which alpha and filter were baked into */
+bool playingFrozen(mixTrack* mixTrack){
+  return mixTrack->freeze != NULL && mixTrack->playback == mixTrack->freeze->frozen;
+}
+
+bool beginAutomation(mixTrack* mixTrack, streamState* state, double frame, unsigned long framesPerBuffer, double startTime){
+  trackAutomation* automation = mixTrack->automation;
+  mixTrackPlayback* playback = mixTrack->playback;
+  double current[AUTOMATION_PARAMS];
+  getAutomationValues(mixTrack, current);
+  automation_begin(automation, frame, startTime, state->playback->period, current);
+  double end = frame + framesPerBuffer;
+
+  /* filter and alpha act on the stretcher's input a window at a time, they follow the buffer's start.
+  new points for them thaw a frozen track, ones queued before it froze pass by while it plays the render */
+  if(!playingFrozen(mixTrack)){
+    float filter = automation_value(automation, AUTOMATE_FILTER, frame, playback->filter);
+    if(filter != playback->filter){
+      playback->filter = filter;
+      updateMixTrackFilter(mixTrack);
+    }
+    playback->alpha = automation_value(automation, AUTOMATE_ALPHA, frame, playback->alpha);
+  }
+
+  bool gainAutomated = automation_active(automation, AUTOMATE_VOLUME, end) || automation_active(automation, AUTOMATE_PLAYING, end);
+  if(!gainAutomated) return false;
+  /* volume and playing are applied per frame at the output. a track starting this buffer runs from its
+  start, gated silent up to the point */
+  std::fill(mixTrack->automationGain, mixTrack->automationGain + std::min((int)framesPerBuffer, AUTOMATION_FRAMES), 1.);
+  automation_render(automation, AUTOMATE_VOLUME, frame, framesPerBuffer, playback->volume, mixTrack->automationGain);
+  automation_render(automation, AUTOMATE_PLAYING, frame, framesPerBuffer, playback->playing, mixTrack->automationGain);
+  if(!playback->playing && automation_value(automation, AUTOMATE_PLAYING, end - 1, 0) != 0) playback->playing = true;
+  return true;
+}
+
+/* automation that played out this buffer becomes the track's settings. a frozen track's own playback
+gets volume and playing too, so they hold once it thaws */
+void endAutomation(mixTrack* mixTrack, double end){
+  double values[AUTOMATION_PARAMS];
+  bool changed[AUTOMATION_PARAMS];
+  getAutomationValues(mixTrack, values);
+  if(!automation_end(mixTrack->automation, end, values, changed)) return;
+
+  mixTrackPlayback* playback = mixTrack->playback;
+  mixTrackPlayback* own = playingFrozen(mixTrack) ? mixTrack->freeze->playback : NULL;
+  if(changed[AUTOMATE_VOLUME]){
+    playback->volume = values[AUTOMATE_VOLUME];
+    if(own != NULL) own->volume = values[AUTOMATE_VOLUME];
+  }
+  if(changed[AUTOMATE_PLAYING]){
+    playback->playing = values[AUTOMATE_PLAYING] != 0;
+    if(own != NULL) own->playing = values[AUTOMATE_PLAYING] != 0;
+  }
+  if(own != NULL) return;
+  if(changed[AUTOMATE_FILTER] && (float)values[AUTOMATE_FILTER] != playback->filter){
+    playback->filter = values[AUTOMATE_FILTER];
+    updateMixTrackFilter(mixTrack);
+  }
+  if(changed[AUTOMATE_ALPHA]) playback->alpha = values[AUTOMATE_ALPHA];
+}
+
+float getInvAlpha(streamState* state, mixTrackPlayback* playback, int chunkIndex){
+  int chunkLength = playback->chunks[(chunkIndex * 2) + 1];
+  bool periodic = chunkLength != 0 && !playback->aperiodic;
+  return periodic ?
+    chunkLength / (float)state->playback->period * playback->alpha :
+    playback->alpha;
+}
+
+void readWindow(streamState* state, mixTrackPlayback* playback, double sample, ringbuffer* inputBuffer){
+  for(auto sourcePair: playback->sourceTracksParams){
+    if(!( //skip destroyed sources
+      state->sources.find(sourcePair.first) != state->sources.end() 
+      && state->sources[sourcePair.first] != NULL
+      && !state->sources[sourcePair.first]->safe
+    )) continue;
+
+    mixTrackSourceConfig* params = sourcePair.second;
+    source* source = state->sources[sourcePair.first];
+    int length = source->length;
+    int sourcePos = sample - params->offset;
+    /* stems play silent until separation reaches them */
+    if(source->separating != NULL && !separation_ready(source->separating, sourcePos, WINDOW_SIZE)) continue;
+
+    for(int channelIndex=0;channelIndex < CHANNEL_COUNT;channelIndex++){
+      /* decode the window out of the source's storage format */
+      samples_read(source->channels[channelIndex], source->format, length, sourcePos, WINDOW_SIZE, state->readBuffer);
+      float* inputChannel = inputBuffer->channels[channelIndex];
+      int head = inputBuffer->head;
+      for(int inputIndex=0;inputIndex<WINDOW_SIZE;inputIndex++){
+        //mix it before input
+        inputChannel[head] += state->readBuffer[inputIndex] * params->volume * state->window[inputIndex];
+        head = (head + 1) % inputBuffer->size;
+      }
+    }
+  }
+
+  inputBuffer->head = (inputBuffer->head + WINDOW_STEP) % inputBuffer->size;
+}
+
+void feedStretcher(ringbuffer* inputBuffer, float** stretchInput, Dsp::Filter* filter, Stretcher* stretcher, int needed){
+  /* inputbuffer >> stretchInput */
+  for(int inputIndex=0;inputIndex<needed;inputIndex++){
+    for(int channelIndex=0;channelIndex < CHANNEL_COUNT;channelIndex++){
+      stretchInput[channelIndex][inputIndex] = inputBuffer->channels[channelIndex][inputBuffer->tail];
+      inputBuffer->channels[channelIndex][inputBuffer->tail] = 0;
+    }
+    inputBuffer->tail = (inputBuffer->tail + 1) % inputBuffer->size;
+  }
+
+  /* apply effects chain here? */
+  filter->process(needed, stretchInput);
+
+  /* stretchInput >> stretchOutput */
+  stretcher->process(stretchInput, needed);
+}
+
+/* whether the track's next playback is due at the phase wrap rather than a chunk boundary */
+bool nextAtWrap(mixTrack* mixTrack){
+  return mixTrack->hasNext && mixTrack->playback->unpause &&
+    (!mixTrack->playback->playing || mixTrack->playback->aperiodic) &&
+    mixTrack->nextPlayback->playing && mixTrack->nextPlayback->chunks.size() >= 2;
+}
+
+void resetPreroll(mixTrackPreroll* preroll){
+  preroll->pvstretcher->reset();
+  preroll->restretcher->reset();
+  ringbuffer_clear(preroll->inputBuffer);
+  preroll->playback = NULL;
+  preroll->used = false;
+}
+
+Stretcher* getPrerollStretcher(mixTrackPreroll* preroll){
+  return preroll->playback->preservePitch ? (Stretcher*)preroll->pvstretcher : (Stretcher*)preroll->restretcher;
+}
+
+/* warm the track's next playback a few blocks at a time while the wrap it's due at comes round */
+void prerollNext(streamState* state, mixTrack* mixTrack, unsigned long framesPerBuffer){
+  mixTrackPreroll* preroll = mixTrack->preroll;
+  if(mixTrack->prestretchLeaving) return; //warming the track's own playback
+  if(!nextAtWrap(mixTrack)){
+    if(preroll->used) resetPreroll(preroll);
+    return;
+  }
+
+  mixTrackPlayback* next = mixTrack->nextPlayback;
+  if(preroll->playback != next){ //new or replaced from js
+    if(preroll->used) resetPreroll(preroll);
+    preroll->playback = next;
+    preroll->sample = next->chunks[0];
+    preroll->used = true;
+    setFilterCutoff(preroll->filter, next->filter);
+  }
+
+  Stretcher* stretcher = getPrerollStretcher(preroll);
+  stretcher->setTimeRatio(1 / getInvAlpha(state, next, 0));
+  for(int step=0;step<PREROLL_STEPS && stretcher->getAvailable() < (int)framesPerBuffer + PREROLL_FRAMES;step++){
+    int needed = stretcher->getRequired();
+    while(getAvailable(preroll->inputBuffer) < needed){
+      readWindow(state, next, preroll->sample, preroll->inputBuffer);
+      preroll->sample += WINDOW_STEP;
+    }
+    feedStretcher(preroll->inputBuffer, mixTrack->stretchInput, preroll->filter, stretcher, needed);
+  }
+}
+
+/* hand the track over to its warmed pipeline at switchFrame, fading it in over whatever the old one played */
+void switchToPreroll(
+  streamState* state,
+  std::string mixTrackId,
+  mixTrack* mixTrack,
+  float* out,
+  unsigned long framesPerBuffer,
+  int previewHead
+){
+  mixTrackPreroll* preroll = mixTrack->preroll;
+  int from = preroll->switchFrame;
+  preroll->switchFrame = -1;
+
+  applyNextPlayback(mixTrackId, state);
+  mixTrackPlayback* playback = mixTrack->playback;
+  playback->chunkIndex = 0;
+  mixTrack->sample = preroll->sample;
+  std::swap(mixTrack->pvstretcher, preroll->pvstretcher);
+  std::swap(mixTrack->restretcher, preroll->restretcher);
+  std::swap(mixTrack->inputBuffer, preroll->inputBuffer);
+  std::swap(mixTrack->filter, preroll->filter);
+  preroll->playback = NULL; //the old pipeline is reset next buffer
+
+  Stretcher* stretcher = playback->preservePitch ? (Stretcher*)mixTrack->pvstretcher : (Stretcher*)mixTrack->restretcher;
+  float gain = playback->muted ? 0 : playback->volume * state->playback->volume;
+  mixTrack->gain = gain;
+  int count = framesPerBuffer - from;
+  if(count <= 0) return;
+
+  stretcher->retrieve(mixTrack->stretchOutput, count);
+  int fade = std::min(PREROLL_FADE, count);
+  int previewIndex = (previewHead + from) % state->previewBuffer->size;
+  float* output = out + from * CHANNEL_COUNT;
+  for(int frameIndex=0;frameIndex<count;frameIndex++){
+    float frameGain = frameIndex < fade ? gain * frameIndex / fade : gain;
+    for(int channelIndex=0;channelIndex < CHANNEL_COUNT;channelIndex++){
+      float sampleValue = mixTrack->stretchOutput[channelIndex][frameIndex];
+      if(playback->preview) state->previewBuffer->channels[channelIndex][previewIndex] += sampleValue;
+      *output++ += sampleValue * frameGain;
+    }
+    float absValue = fabsf(mixTrack->stretchOutput[0][frameIndex] * frameGain);
+    if(absValue > mixTrack->level) mixTrack->level = absValue;
+    previewIndex = (previewIndex + 1) % state->previewBuffer->size;
+  }
 }
 
 double getSamplePosition(
@@ -30,6 +268,237 @@ int moddiff(const int & x, const int & y, const int & size){
   return diff > (size/2)?size-diff:diff;
 }
 
+int heardChunk(mixTrack* mixTrack, double time){
+  mixTrackPlayback* playback = mixTrack->playback;
+  int chunkCount = playback->chunks.size() / 2;
+  if(playback->chunkIndex < 0 || playback->chunkIndex >= chunkCount) return 0;
+  int chunkLength = playback->chunks[playback->chunkIndex*2+1];
+  if(mixTrack->prestretchActive || chunkLength == 0) return playback->chunkIndex;
+  /* the stretchers read ahead of what's heard, their chunk may already be the next one */
+  double phase = playback->alpha * time;
+  phase -= floor(phase);
+  double readPhase = (mixTrack->sample - getSamplePosition(playback, 0)) / chunkLength;
+  return phase - readPhase > 0.5 ? (playback->chunkIndex + chunkCount - 1) % chunkCount : playback->chunkIndex;
+}
+
+bool prestretchMatches(streamState* state, prestretchConfig* config, mixTrack* mixTrack){
+  mixTrackPlayback* playback = mixTrack->playback;
+  if(
+    playback != config->playback || playback->alpha != config->alpha || state->playback->period != config->period ||
+    !playback->playing || !playback->loop || playback->aperiodic || !playback->preservePitch || mixTrack->hasNext ||
+    playback->chunks != config->chunks || playback->sourceTracksParams.size() != config->sources.size()
+  ) return false;
+  for(unsigned int i=0;i<config->sources.size();i++){
+    prestretchSource& configSource = config->sources[i];
+    auto found = playback->sourceTracksParams.find(configSource.sourceId);
+    if(
+      found == playback->sourceTracksParams.end() || found->second != configSource.params ||
+      configSource.params->volume != configSource.volume || configSource.params->offset != configSource.offset
+    ) return false;
+    if(configSource.volume == 0) continue;
+    auto source = state->sources.find(configSource.sourceId);
+    if(source == state->sources.end() || source->second == NULL || source->second->removed) return false;
+  }
+  return true;
+}
+
+/* start the live stretchers over, whatever they held is stale */
+void resetStretchers(mixTrack* mixTrack){
+  mixTrack->pvstretcher->reset();
+  mixTrack->restretcher->reset();
+  ringbuffer_clear(mixTrack->inputBuffer);
+}
+
+void refreshPlayback(streamState* state, mixTrack* mixTrack, double startTime){
+  mixTrackPlayback* playback = mixTrack->playback;
+  mixTrack->swapped = false;
+  mixTrack->prestretchActive = false;
+  mixTrack->prestretchLeaving = false;
+  resetStretchers(mixTrack);
+  if(playback->chunkIndex >= 0 && playback->chunkIndex * 2 + 1 < (int)playback->chunks.size()){
+    double phase = playback->alpha * startTime;
+    mixTrack->sample = getSamplePosition(playback, phase - floor(phase));
+  }
+}
+
+/* one buffer of the loop into stretchOutput, fading in over fade frames */
+void readLoop(
+  streamState* state,
+  std::string mixTrackId,
+  mixTrack* mixTrack,
+  prestretchLoop* loop,
+  double startTime,
+  unsigned long framesPerBuffer,
+  int fade
+){
+  mixTrackPlayback* playback = mixTrack->playback;
+  recording* rec = state->recording;
+  int chunkCount = playback->chunks.size() / 2;
+  for(int frameIndex=0;frameIndex<framesPerBuffer;frameIndex++){
+    double phase = playback->alpha * (startTime + (double)frameIndex / state->playback->period);
+    phase -= floor(phase);
+    if(phase < mixTrack->prestretchPhase){ //chunk boundary
+      if(rec != NULL && rec->fromSourceId == mixTrackId && !rec->started){
+        rec->started = true;
+        pushEvent(state, EVENT_RECORDING, -1, 0);
+        rec->fromSourceOffset = getSamplePosition(playback, 1);
+      }
+      playback->chunkIndex = (playback->chunkIndex + 1) % chunkCount;
+      pushEvent(state, EVENT_CHUNK, mixTrack->timingSlot, playback->chunkIndex);
+    }
+    mixTrack->prestretchPhase = phase;
+
+    size_t index = (size_t)playback->chunkIndex * loop->chunkFrames + std::min((int)(phase * loop->chunkOut), loop->chunkFrames - 1);
+    float gain = frameIndex < fade ? (float)frameIndex / fade : 1;
+    for(int channelIndex=0;channelIndex < CHANNEL_COUNT;channelIndex++)
+      mixTrack->stretchOutput[channelIndex][frameIndex] = loop->channels[channelIndex][index] * gain;
+  }
+
+  mixTrack->sample = getSamplePosition(playback, mixTrack->prestretchPhase);
+  mixTrack->filter->process(framesPerBuffer, mixTrack->stretchOutput);
+}
+
+/* the loop stopped matching. rather than have the live stretchers refill from nothing, the loop plays on
+while the idle preroll pipeline warms the playback from where it's heard. false if the loop no longer
+fits the playback's chunks or the preroll is wanted for a next playback */
+bool leavePrestretch(streamState* state, mixTrack* mixTrack, double startTime){
+  prestretchLoop* loop = mixTrack->prestretch;
+  mixTrackPlayback* playback = mixTrack->playback;
+  mixTrackPreroll* preroll = mixTrack->preroll;
+  int chunkCount = playback->chunks.size() / 2;
+  if(
+    loop == NULL || playback != loop->config.playback || playback->chunks != loop->config.chunks ||
+    !playback->loop || mixTrack->hasNext || chunkCount == 0
+  ) return false;
+
+  if(preroll->used) resetPreroll(preroll);
+  double phase = playback->alpha * startTime;
+  phase -= floor(phase);
+  preroll->playback = playback;
+  preroll->chunkIndex = phase < mixTrack->prestretchPhase ? (playback->chunkIndex + 1) % chunkCount : playback->chunkIndex;
+  preroll->sample = playback->chunks[preroll->chunkIndex*2] + playback->chunks[preroll->chunkIndex*2+1] * phase;
+  preroll->used = true;
+  setFilterCutoff(preroll->filter, playback->filter);
+  mixTrack->prestretchLeaving = true;
+  mixTrack->prestretchLeft = 0;
+  return true;
+}
+
+/* play the loop on and warm the live pipeline a few blocks a buffer. once it holds what's been heard since
+leaving and a buffer more, the heard part is dropped and it takes over, crossfaded from the loop. false if
+it gave up and the track's own stretchers have to fill */
+bool readLeaving(
+  streamState* state,
+  std::string mixTrackId,
+  mixTrack* mixTrack,
+  double startTime,
+  unsigned long framesPerBuffer
+){
+  mixTrackPlayback* playback = mixTrack->playback;
+  mixTrackPreroll* preroll = mixTrack->preroll;
+  prestretchLoop* loop = mixTrack->prestretch;
+  if(
+    preroll->playback != playback || playback->chunks != loop->config.chunks || !playback->loop ||
+    mixTrack->hasNext || mixTrack->prestretchLeft > PREROLL_LEAVE_MAX
+  ){
+    mixTrack->prestretchLeaving = false;
+    resetPreroll(preroll);
+    return false;
+  }
+
+  Stretcher* stretcher = getPrerollStretcher(preroll);
+  int chunkCount = playback->chunks.size() / 2;
+  int wanted = mixTrack->prestretchLeft + framesPerBuffer;
+  for(int step=0;step<PREROLL_STEPS && stretcher->getAvailable() < wanted;step++){
+    stretcher->setTimeRatio(1 / getInvAlpha(state, playback, preroll->chunkIndex));
+    int needed = stretcher->getRequired();
+    while(getAvailable(preroll->inputBuffer) < needed){
+      readWindow(state, playback, preroll->sample, preroll->inputBuffer);
+      preroll->sample += WINDOW_STEP;
+      int chunkLength = playback->chunks[preroll->chunkIndex*2+1];
+      double chunkEnd = playback->chunks[preroll->chunkIndex*2] + chunkLength;
+      if(chunkLength != 0 && preroll->sample > chunkEnd){
+        preroll->chunkIndex = (preroll->chunkIndex + 1) % chunkCount;
+        preroll->sample = playback->chunks[preroll->chunkIndex*2] + (preroll->sample - chunkEnd);
+      }
+    }
+    feedStretcher(preroll->inputBuffer, mixTrack->stretchInput, preroll->filter, stretcher, needed);
+  }
+
+  readLoop(state, mixTrackId, mixTrack, loop, startTime, framesPerBuffer, 0);
+  if(stretcher->getAvailable() < wanted){
+    mixTrack->prestretchLeft += framesPerBuffer;
+    return true;
+  }
+
+  /* drop what the loop played while warming, the rest lines up with it */
+  for(int left=mixTrack->prestretchLeft;left>0;left-=WINDOW_SIZE * 8)
+    stretcher->retrieve(mixTrack->stretchInput, std::min(left, WINDOW_SIZE * 8));
+  stretcher->retrieve(mixTrack->stretchInput, framesPerBuffer);
+  int fade = std::min(PREROLL_FADE, (int)framesPerBuffer);
+  for(int channelIndex=0;channelIndex < CHANNEL_COUNT;channelIndex++){
+    float* output = mixTrack->stretchOutput[channelIndex];
+    float* warmed = mixTrack->stretchInput[channelIndex];
+    for(int frameIndex=0;frameIndex<framesPerBuffer;frameIndex++){
+      float mix = frameIndex < fade ? (float)frameIndex / fade : 1;
+      output[frameIndex] = output[frameIndex] * (1 - mix) + warmed[frameIndex] * mix;
+    }
+  }
+
+  mixTrack->sample = preroll->sample;
+  if(playback->chunkIndex != preroll->chunkIndex){
+    playback->chunkIndex = preroll->chunkIndex;
+    pushEvent(state, EVENT_CHUNK, mixTrack->timingSlot, playback->chunkIndex);
+  }
+  std::swap(mixTrack->pvstretcher, preroll->pvstretcher);
+  std::swap(mixTrack->restretcher, preroll->restretcher);
+  std::swap(mixTrack->inputBuffer, preroll->inputBuffer);
+  std::swap(mixTrack->filter, preroll->filter);
+  preroll->playback = NULL; //the old pipeline is reset next buffer
+  mixTrack->prestretchLeaving = false;
+  return true;
+}
+
+bool readPrestretch(
+  streamState* state,
+  std::string mixTrackId,
+  mixTrack* mixTrack,
+  double startTime,
+  unsigned long framesPerBuffer
+){
+  prestretchLoop* loop = mixTrack->prestretch;
+  if(loop == NULL || loop->removed || !prestretchMatches(state, &loop->config, mixTrack)){
+    if(mixTrack->prestretchActive){
+      mixTrack->prestretchActive = false;
+      resetStretchers(mixTrack);
+      leavePrestretch(state, mixTrack, startTime);
+    }
+    if(mixTrack->prestretchLeaving) return readLeaving(state, mixTrackId, mixTrack, startTime, framesPerBuffer);
+    return false;
+  }
+
+  mixTrackPlayback* playback = mixTrack->playback;
+  int chunkCount = playback->chunks.size() / 2;
+  double phase = playback->alpha * startTime;
+  phase -= floor(phase);
+  int fade = 0;
+  if(playback->chunkIndex < 0 || playback->chunkIndex >= chunkCount) playback->chunkIndex = 0;
+  if(mixTrack->prestretchLeaving){ //matches again before the live pipeline took over, the loop never stopped
+    mixTrack->prestretchLeaving = false;
+    resetPreroll(mixTrack->preroll);
+    mixTrack->prestretchActive = true;
+  }
+  if(!mixTrack->prestretchActive){
+    playback->chunkIndex = heardChunk(mixTrack, startTime);
+    mixTrack->prestretchActive = true;
+    mixTrack->prestretchPhase = phase;
+    fade = PREROLL_FADE;
+  }
+
+  readLoop(state, mixTrackId, mixTrack, loop, startTime, framesPerBuffer, fade);
+  return true;
+}
+
 int paCallbackMethod(
   const void *inputBuffer, 
   void *outputBuffer,
@@ -42,15 +511,35 @@ int paCallbackMethod(
   float *out = (float*)outputBuffer;
   recording* rec = state->recording;
   double startTime = state->playback->time;
+  double frame = events_frame();
 
   for(unsigned int frameIndex=0; frameIndex<framesPerBuffer*2; frameIndex++ ) *(out+frameIndex) = 0;
-  if(!state->playback->playing) return paContinue;
+  if(!state->playback->playing){
+    if(!state->offline){
+      publishTiming(state);
+      events_end(framesPerBuffer);
+    }
+    return paContinue;
+  }
 
   int previewHead = state->previewBuffer->head;
 
+  /* where in this buffer the phase wraps, warmed next playbacks take over right there */
+  double endTime = startTime + ((double)framesPerBuffer / state->playback->period);
+  bool wraps = startTime-floor(startTime) > endTime-floor(endTime);
+  int wrapFrame = std::min((int)round((floor(startTime) + 1 - startTime) * state->playback->period), (int)framesPerBuffer);
+
   for(auto mixTrackPair: state->mixTracks){
     mixTrack* mixTrack = mixTrackPair.second;
     if(!mixTrack || mixTrack->removed || mixTrack->safe) continue;
+    if(mixTrack->swapped) refreshPlayback(state, mixTrack, startTime);
+    bool gainAutomated = beginAutomation(mixTrack, state, frame, framesPerBuffer, startTime);
+
+    prerollNext(state, mixTrack, framesPerBuffer);
+    mixTrackPreroll* preroll = mixTrack->preroll;
+    preroll->switchFrame = wraps && preroll->playback != NULL && !mixTrack->prestretchLeaving &&
+      getPrerollStretcher(preroll)->getAvailable() >= (int)framesPerBuffer - wrapFrame ? wrapFrame : -1;
+    bool nextWaits = preroll->switchFrame >= 0; //the wrap takes it, not a chunk boundary
         
     Stretcher* stretcher;
     if(mixTrack->playback->preservePitch) stretcher = mixTrack->pvstretcher;
@@ -62,10 +551,13 @@ int paCallbackMethod(
         stretcher->reset();
         ringbuffer_clear(mixTrack->inputBuffer);
       }
+      mixTrack->prestretchActive = false;
+      mixTrack->prestretchLeaving = false;
       continue;
     }
 
-    while(stretcherAvailable < framesPerBuffer){
+    bool prestretched = readPrestretch(state, mixTrackPair.first, mixTrack, startTime, framesPerBuffer);
+    while(!prestretched && stretcherAvailable < framesPerBuffer){
       /* read from source >> inputbuffer */
       int needed = stretcher->getRequired();
       int readAvailable = getAvailable(mixTrack->inputBuffer);
@@ -89,10 +581,7 @@ int paCallbackMethod(
         bool periodic = hasEnd && !playback->aperiodic;
         double chunkEndPosition = getSamplePosition(playback, 1);
 
-        float invAlpha = periodic ?
-          chunkLength / (float)state->playback->period * playback->alpha :
-          playback->alpha;
-        float alpha = 1 / invAlpha;
+        float alpha = 1 / getInvAlpha(state, playback, playback->chunkIndex);
 
         stretcher->setTimeRatio(alpha);
         //stretcher->setPitchRatio(invAlpha);
@@ -105,33 +594,8 @@ int paCallbackMethod(
             //std::cout << "cr " << sampleDelta << std::endl;
           }
         }
-       
-        for(auto sourcePair: playback->sourceTracksParams){
-          if(!( //skip destroyed sources
-            state->sources.find(sourcePair.first) != state->sources.end() 
-            && state->sources[sourcePair.first] != NULL
-            && !state->sources[sourcePair.first]->safe
-          )) continue;
-
-          mixTrackSourceConfig* params = sourcePair.second;
-          source* source = state->sources[sourcePair.first];
-          int length = source->length;
-          int sourcePos = mixTrack->sample - params->offset;
-
-          int head = mixTrack->inputBuffer->head;
-          for(int inputIndex=0;inputIndex<WINDOW_SIZE;inputIndex++){
-            for(int channelIndex=0;channelIndex < CHANNEL_COUNT;channelIndex++){
-              int pos = sourcePos + inputIndex;
-              float sampleValue = (pos < length && pos >= 0) ? source->channels[channelIndex][pos] : 0;
-              sampleValue *= params->volume; //mix it before input
-              sampleValue *= state->window[inputIndex];
-              mixTrack->inputBuffer->channels[channelIndex][head] += sampleValue;
-            }
-            head = (head + 1) % mixTrack->inputBuffer->size;
-          }
-        }
 
-        mixTrack->inputBuffer->head = (mixTrack->inputBuffer->head + WINDOW_STEP) % mixTrack->inputBuffer->size;
+        readWindow(state, playback, mixTrack->sample, mixTrack->inputBuffer);
         int nextReadAvailable = getAvailable(mixTrack->inputBuffer);
         if(nextReadAvailable == readAvailable) break;
         readAvailable = nextReadAvailable;
@@ -139,43 +603,31 @@ int paCallbackMethod(
         mixTrack->sample += WINDOW_STEP;
         if(hasEnd && mixTrack->sample > chunkEndPosition){ //chunk boundary
           playback->chunkIndex = (playback->chunkIndex + 1) % chunkCount;
-          bool hasNext = mixTrack->hasNext && (playback->chunkIndex == 0 || playback->nextAtChunk);
+          bool hasNext = mixTrack->hasNext && !nextWaits && (playback->chunkIndex == 0 || playback->nextAtChunk);
           double nextChunkStart = hasNext ?
             mixTrack->nextPlayback->chunks[0] : 
             playback->chunks[playback->chunkIndex * 2];
 
-          if(!mixTrack->hasNext && playback->chunkIndex == 0 && !playback->loop){
+          if(!hasNext && playback->chunkIndex == 0 && !playback->loop){
             playback->playing = false;
             playback->chunkIndex = -1;
+            pushEvent(state, EVENT_STOPPED, mixTrack->timingSlot, -1);
           }else{
             mixTrack->sample = nextChunkStart + (mixTrack->sample - chunkEndPosition);
-            if(mixTrack->hasNext && (playback->chunkIndex == 0 || playback->nextAtChunk)){
+            if(hasNext){
               applyNextPlayback(mixTrackPair.first, state);
               playback->chunkIndex = 0;
-            } 
+            }else pushEvent(state, EVENT_CHUNK, mixTrack->timingSlot, playback->chunkIndex);
             if(rec != NULL && rec->fromSourceId == mixTrackPair.first && !rec->started){
               rec->started = true;
+              pushEvent(state, EVENT_RECORDING, -1, 0);
               rec->fromSourceOffset = chunkEndPosition;
             }
           }
         }
       }
 
-      /* inputbuffer >> stretchInput */
-      for(int inputIndex=0;inputIndex<needed;inputIndex++){
-        for(int channelIndex=0;channelIndex < CHANNEL_COUNT;channelIndex++){
-          mixTrack->stretchInput[channelIndex][inputIndex] = 
-            mixTrack->inputBuffer->channels[channelIndex][mixTrack->inputBuffer->tail];
-          mixTrack->inputBuffer->channels[channelIndex][mixTrack->inputBuffer->tail] = 0;
-        }
-        mixTrack->inputBuffer->tail = (mixTrack->inputBuffer->tail + 1) % mixTrack->inputBuffer->size;
-      }
-
-      /* apply effects chain here? */
-      mixTrack->filter->process(needed, mixTrack->stretchInput);
-
-      /* stretchInput >> stretchOutput */
-      stretcher->process(mixTrack->stretchInput, needed);
+      feedStretcher(mixTrack->inputBuffer, mixTrack->stretchInput, mixTrack->filter, stretcher, needed);
       int nextStretcherAvailable = stretcher->getAvailable();
       if(nextStretcherAvailable == stretcherAvailable) break;
       stretcherAvailable = nextStretcherAvailable;
@@ -184,20 +636,28 @@ int paCallbackMethod(
     /* stretchOutput >> paOutput */
     float desiredGain = mixTrack->playback->volume * state->playback->volume;
     if(mixTrack->playback->muted) desiredGain = 0;
-    float gainStep = (desiredGain - mixTrack->gain) / WINDOW_SIZE;
+    float gainStep = gainAutomated ? 0 : (desiredGain - mixTrack->gain) / WINDOW_SIZE;
 
-    if(stretcherAvailable >= framesPerBuffer){
-      stretcher->retrieve(mixTrack->stretchOutput, framesPerBuffer);
+    mixTrack->level *= 0.99;
+    if(prestretched || stretcherAvailable >= framesPerBuffer){
+      if(!prestretched) stretcher->retrieve(mixTrack->stretchOutput, framesPerBuffer);
       float* output = (float*)outputBuffer;
       int trackPreviewHead = previewHead;
+      int fadeFrom = nextWaits ? preroll->switchFrame : framesPerBuffer;
       for(int frameIndex=0;frameIndex<framesPerBuffer;frameIndex++){
+        if(gainAutomated)
+          mixTrack->gain = mixTrack->playback->muted ? 0 : mixTrack->automationGain[std::min(frameIndex, AUTOMATION_FRAMES - 1)] * state->playback->volume;
+        /* fade out under the warmed next playback taking over */
+        float fade = frameIndex < fadeFrom ? 1 : std::max(0.f, 1 - (float)(frameIndex - fadeFrom) / PREROLL_FADE);
         for(int channelIndex=0;channelIndex < CHANNEL_COUNT;channelIndex++){
-          float sampleValue = mixTrack->stretchOutput[channelIndex][frameIndex];
+          float sampleValue = mixTrack->stretchOutput[channelIndex][frameIndex] * fade;
           if(mixTrack->playback->preview)
             state->previewBuffer->channels[channelIndex][trackPreviewHead] += sampleValue;
 
           *output++ += sampleValue * mixTrack->gain;
         }
+        float absValue = fabsf(mixTrack->stretchOutput[0][frameIndex] * fade * mixTrack->gain);
+        if(absValue > mixTrack->level) mixTrack->level = absValue;
         mixTrack->gain = mixTrack->gain + gainStep;
         trackPreviewHead = (trackPreviewHead + 1) % state->previewBuffer->size;
       }
@@ -205,6 +665,12 @@ int paCallbackMethod(
     
   }
 
+  for(auto mixTrackPair: state->mixTracks){
+    mixTrack* mixTrack = mixTrackPair.second;
+    if(mixTrack && !mixTrack->removed && !mixTrack->safe && mixTrack->preroll->switchFrame >= 0)
+      switchToPreroll(state, mixTrackPair.first, mixTrack, out, framesPerBuffer, previewHead);
+  }
+
   if(rec != NULL && rec->started){
     recordChunk* chunk = rec->chunks[rec->chunkIndex];
     for(unsigned int frameIndex=0; frameIndex<framesPerBuffer; frameIndex++ ){
@@ -233,6 +699,7 @@ int paCallbackMethod(
 
   /* phase wrapped drung this callback */
   if(startTime-floor(startTime) > state->playback->time-floor(state->playback->time)){
+    pushEvent(state, EVENT_PHASE, -1, floor(state->playback->time));
     /* unpause any tracks as needed */
     for(auto mixTrackPair: state->mixTracks){
       mixTrack* mixTrack = mixTrackPair.second;
@@ -246,7 +713,10 @@ int paCallbackMethod(
     }
     /* add bounds to recording */
     if(rec != NULL){
-      if(!rec->started && !rec->fromSource) rec->started = true;
+      if(!rec->started && !rec->fromSource){
+        rec->started = true;
+        pushEvent(state, EVENT_RECORDING, -1, 0);
+      }
       recordChunk* currentChunk = rec->chunks[rec->chunkIndex];
       currentChunk->bounds[currentChunk->boundsCount] = rec->length;
       currentChunk->boundsCount++;
@@ -267,10 +737,48 @@ int paCallbackMethod(
       if(REPSYS_LOG) std::cout << "safe track" << mixTrackPair.first << std::endl;
       mixTrack->safe = true;
     }
+    if(mixTrack && mixTrack->prestretch != NULL && mixTrack->prestretch->removed && !mixTrack->prestretch->safe &&
+      !mixTrack->prestretchLeaving)
+      mixTrack->prestretch->safe = true;
+    if(mixTrack && mixTrack->freeze != NULL && mixTrack->freeze->removed && !mixTrack->freeze->safe)
+      mixTrack->freeze->safe = true;
+  }
+
+  for(auto mixTrackPair: state->mixTracks){
+    mixTrack* mixTrack = mixTrackPair.second;
+    if(mixTrack && !mixTrack->removed) endAutomation(mixTrack, frame + framesPerBuffer);
+  }
+
+  if(!state->offline){
+    publishTiming(state);
+    events_end(framesPerBuffer);
   }
   return paContinue;
 }
 
+void publishTiming(streamState* state){
+  timing_begin();
+  timing_set(TIMING_TIME, state->playback->time);
+  timing_set(TIMING_REC_TIME, state->recording != NULL ? state->recording->length : 0);
+  timing_set(TIMING_MAX_LEVEL, state->playback->maxLevel);
+  timing_set(TIMING_FRAME, events_frame());
+  for(auto mixTrackPair: state->mixTracks){
+    mixTrack* mixTrack = mixTrackPair.second;
+    if(!mixTrack || mixTrack->removed || mixTrack->timingSlot < 0) continue;
+    int slot = mixTrack->timingSlot;
+    timing_set_track(slot, TIMING_TRACK_SAMPLE, mixTrack->sample);
+    timing_set_track(slot, TIMING_TRACK_CHUNK_INDEX, mixTrack->playback->chunkIndex);
+    timing_set_track(slot, TIMING_TRACK_PLAYING, mixTrack->playback->playing);
+    timing_set_track(slot, TIMING_TRACK_HAS_NEXT, mixTrack->hasNext);
+    if(mixTrack->hasNext){
+      timing_set_track(slot, TIMING_TRACK_NEXT_CHUNK_INDEX, mixTrack->nextPlayback->chunkIndex);
+      timing_set_track(slot, TIMING_TRACK_NEXT_PLAYING, mixTrack->nextPlayback->playing);
+    }
+    timing_set_track(slot, TIMING_TRACK_LEVEL, mixTrack->level);
+  }
+  timing_end();
+}
+
 int paPreviewCallbackMethod(
   const void *inputBuffer, 
   void *outputBuffer,
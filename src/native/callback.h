@@ -24,6 +24,42 @@ void copyToOut(
 
 void applyNextPlayback(mixTrack * mixTrack);
 
+void setFilterCutoff(Dsp::Filter* filter, float cutoff);
+
+/* point the track's filter at its playback's cutoff */
+void updateMixTrackFilter(mixTrack* mixTrack);
+
+/* stretch factor for a playback's chunk, chunks sized to the period are fit to it */
+float getInvAlpha(streamState* state, mixTrackPlayback* playback, int chunkIndex);
+
+/* mix a window of playback's sources from sample into the head of inputBuffer, for overlap add */
+void readWindow(streamState* state, mixTrackPlayback* playback, double sample, ringbuffer* inputBuffer);
+
+/* move needed samples from inputBuffer through filter into stretcher */
+void feedStretcher(ringbuffer* inputBuffer, float** stretchInput, Dsp::Filter* filter, Stretcher* stretcher, int needed);
+
+/* the chunk of a periodic track heard at time, rather than the one its stretchers are reading */
+int heardChunk(mixTrack* mixTrack, double time);
+
+/* whether the track still plays the loop config was taken from, so a prestretch of it can stand in */
+bool prestretchMatches(streamState* state, prestretchConfig* config, mixTrack* mixTrack);
+
+/* pick up a playback swapped in from js, starting the stretchers over where it is now */
+void refreshPlayback(streamState* state, mixTrack* mixTrack, double startTime);
+
+/* fill the track's stretchOutput for this buffer from its prestretched loop, false if it has none that
+matches and the live stretchers have to run */
+bool readPrestretch(
+  streamState* state,
+  std::string mixTrackId,
+  mixTrack* mixTrack,
+  double startTime,
+  unsigned long framesPerBuffer
+);
+
+/* write the timing snapshot js polls, audio thread only */
+void publishTiming(streamState* state);
+
 int paCallbackMethod(
   const void *inputBuffer, 
   void *outputBuffer,
@@ -9,5 +9,11 @@ static int MAX_ALPHA = 10;
 static int WINDOW_SIZE =  OVERLAP_COUNT * WINDOW_STEP;
 static int SAMPLE_RATE = 44100;
 static int DELAY_MAX_SIZE = SAMPLE_RATE * 10;
+static int PREROLL_FRAMES = WINDOW_SIZE * 2; //warmed output kept ready beyond a buffer
+static int PREROLL_STEPS = 4; //stretcher blocks warmed per callback at most
+static int PREROLL_FADE = 64; //crossfade frames when a warmed playback takes over
+static int PREROLL_LEAVE_MAX = SAMPLE_RATE / 2; //longest a prestretched loop plays on while the live pipeline warms
+static int FREEZE_BLOCK = WINDOW_SIZE * 2; //frames a frozen track is rendered in at once
+static int FREEZE_MAX = SAMPLE_RATE * 60 * 5; //longest render a track can be frozen to
 
 #endif
\ No newline at end of file
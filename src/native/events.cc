@@ -0,0 +1,51 @@
+#include "events.h"
+
+static engineEvent queue[EVENTS_SIZE];
+static std::atomic<unsigned int> head(0); //written by the audio thread
+static std::atomic<unsigned int> tail(0); //written by the notifier
+static double frameClock = 0;
+static bool pushed = false;
+
+static std::mutex waitLock;
+static std::condition_variable waiting;
+
+void events_push(int type, int slot, int value){
+  if(type != EVENT_PHASE && type != EVENT_RECORDING && slot < 0) return;
+  unsigned int h = head.load(std::memory_order_relaxed);
+  if(h - tail.load(std::memory_order_acquire) >= (unsigned int)EVENTS_SIZE) return; //full
+  engineEvent* event = &queue[h % EVENTS_SIZE];
+  event->type = type;
+  event->slot = slot;
+  event->value = value;
+  event->frame = frameClock;
+  head.store(h + 1, std::memory_order_release);
+  pushed = true;
+}
+
+double events_frame(){
+  return frameClock;
+}
+
+void events_end(unsigned long frames){
+  frameClock += frames;
+  if(!pushed) return;
+  pushed = false;
+  /* no lock here, the audio thread can't wait on one. a wakeup lost to the race is caught by the wait timeout */
+  waiting.notify_one();
+}
+
+void events_wait(){
+  std::unique_lock<std::mutex> lock(waitLock);
+  waiting.wait_for(lock, std::chrono::milliseconds(EVENTS_WAIT), [](){
+    return head.load(std::memory_order_acquire) != tail.load(std::memory_order_relaxed);
+  });
+}
+
+int events_drain(engineEvent* out, int max){
+  unsigned int t = tail.load(std::memory_order_relaxed);
+  unsigned int h = head.load(std::memory_order_acquire);
+  int count = 0;
+  while(t != h && count < max) out[count++] = queue[t++ % EVENTS_SIZE];
+  tail.store(t, std::memory_order_release);
+  return count;
+}
@@ -0,0 +1,43 @@
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#ifndef EVENTS_HEADER_H
+#define EVENTS_HEADER_H
+
+/* things the audio thread did that js reacts to, queued without locks and drained by a notifier thread */
+static const int EVENTS_SIZE = 1024; //events queued at once, more are dropped
+static const int EVENTS_WAIT = 100; //ms the notifier sleeps for if it misses a wakeup
+
+enum engineEventType {
+  EVENT_CHUNK, //track moved on to value's chunk
+  EVENT_NEXT, //track's next playback took over, from its first chunk
+  EVENT_STOPPED, //track reached the end without looping
+  EVENT_PHASE, //global phase wrapped, value is the new bar
+  EVENT_RECORDING //recording started
+};
+
+typedef struct{
+  int type;
+  int slot; //timing slot of the track, -1 for global events
+  int value;
+  double frame; //output frames since the engine started, at the start of the buffer it happened in
+} engineEvent;
+
+/* audio thread only. events for tracks without a timing slot are dropped */
+void events_push(int type, int slot, int value);
+
+/* output frames since the engine started, up to the start of the current buffer. audio thread only */
+double events_frame();
+
+/* audio thread, once per buffer: moves the frame clock on and wakes the notifier if anything was queued */
+void events_end(unsigned long frames);
+
+/* notifier thread only, block until there might be events */
+void events_wait();
+
+/* notifier thread only, move up to max queued events into out */
+int events_drain(engineEvent* out, int max);
+
+#endif
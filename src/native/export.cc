@@ -1,4 +1,5 @@
 #include "export.h"
+#include "cache.h"
 
 void encode_audio_frame(
   AVFrame *frame,
@@ -29,13 +30,52 @@ void encode_audio_frame(
   av_packet_unref(&output_packet);
 }
 
+int export_codec(std::string name){
+  if(name == "wav") return EXPORT_WAV;
+  if(name == "flac") return EXPORT_FLAC;
+  return EXPORT_AAC;
+}
+
+/* fill one frame from the source, planar formats read straight into the frame */
+void fill_export_frame(AVFrame* frame, AVCodecContext* avctx, source* expSource, int start, int count, float** scratch){
+  if(avctx->sample_fmt == AV_SAMPLE_FMT_FLTP){
+    for(int channelIndex=0;channelIndex<avctx->channels;channelIndex++)
+      samples_read(
+        expSource->channels[channelIndex], expSource->format, expSource->length, 
+        start, count, (float*)frame->data[channelIndex]
+      );
+    return;
+  }
+
+  for(int channelIndex=0;channelIndex<avctx->channels;channelIndex++)
+    samples_read(expSource->channels[channelIndex], expSource->format, expSource->length, start, count, scratch[channelIndex]);
+  if(avctx->sample_fmt == AV_SAMPLE_FMT_FLT){
+    float* dest = (float*)frame->data[0];
+    for(int i=0;i<count;i++)
+      for(int channelIndex=0;channelIndex<avctx->channels;channelIndex++)
+        *dest++ = scratch[channelIndex][i];
+  }else{
+    int16_t* dest = (int16_t*)frame->data[0];
+    for(int i=0;i<count;i++)
+      for(int channelIndex=0;channelIndex<avctx->channels;channelIndex++)
+        *dest++ = lrintf(std::max(std::min(scratch[channelIndex][i], 1.f), -1.f) * 32767);
+  }
+}
+
 void free_export(AVCodecContext* avctx, AVFormatContext* output_format_context){
   avcodec_free_context(&avctx);
   avio_closep(&output_format_context->pb);
   avformat_free_context(output_format_context);
 }
 
-bool exportSrc(std::string path, source* expSource){
+bool export_encode(
+  std::string path, 
+  source* expSource, 
+  int codec,
+  std::function<void(float)> progress,
+  std::atomic<bool>* cancelled,
+  int threads
+){
   bool result = false;
   unsigned int sourceLen = expSource->length; 
 
@@ -61,9 +101,10 @@ bool exportSrc(std::string path, source* expSource){
     return result;
   }
 
-  output_format_context->oformat = av_guess_format(NULL, "yas.m4a", NULL);
+  const char* container = codec == EXPORT_WAV ? "out.wav" : codec == EXPORT_FLAC ? "out.flac" : "out.m4a";
+  output_format_context->oformat = av_guess_format(NULL, container, NULL);
   if(!output_format_context->oformat){
-    std::cout << "couldn't find m4a format??" << std::endl;
+    std::cout << "couldn't find format for " << container << std::endl;
     free_export(avctx, output_format_context);
     return result;
   }
@@ -71,9 +112,10 @@ bool exportSrc(std::string path, source* expSource){
   output_format_context->pb = output_io_context;
   output_format_context->url = av_strdup(path.c_str());
 
-  output_codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
+  AVCodecID codecId = codec == EXPORT_WAV ? AV_CODEC_ID_PCM_F32LE : codec == EXPORT_FLAC ? AV_CODEC_ID_FLAC : AV_CODEC_ID_AAC;
+  output_codec = avcodec_find_encoder(codecId);
   if(!output_codec){
-    std::cout << "couldn't find AV_CODEC_ID_AAC" << std::endl;
+    std::cout << "couldn't find encoder " << codecId << std::endl;
     free_export(avctx, output_format_context);
     return result;
   }
@@ -94,10 +136,16 @@ bool exportSrc(std::string path, source* expSource){
   avctx->channels = 2;
   avctx->channel_layout = AV_CH_LAYOUT_STEREO;
   avctx->sample_rate = 44100;
-  avctx->sample_fmt = AV_SAMPLE_FMT_FLTP;
-  avctx->bit_rate = 250000;
-  avctx->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
-  avctx->initial_padding = 1024;
+  if(codec == EXPORT_WAV) avctx->sample_fmt = AV_SAMPLE_FMT_FLT;
+  else if(codec == EXPORT_FLAC) avctx->sample_fmt = AV_SAMPLE_FMT_S16;
+  else{
+    avctx->sample_fmt = AV_SAMPLE_FMT_FLTP;
+    avctx->bit_rate = 250000;
+    avctx->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+    avctx->initial_padding = 1024;
+  }
+  avctx->thread_count = threads;
+  avctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
 
   stream->time_base.den = 44100;
   stream->time_base.num = 1;
@@ -128,9 +176,9 @@ bool exportSrc(std::string path, source* expSource){
     return result;
   }
 
-  AVPacket* pkt = av_packet_alloc();
   AVFrame* frame = av_frame_alloc();
-  frame->nb_samples = avctx->frame_size;
+  int frameSize = avctx->frame_size > 0 ? avctx->frame_size : EXPORT_FRAME_SAMPLES;
+  frame->nb_samples = frameSize;
   frame->format = avctx->sample_fmt;
   frame->channel_layout = avctx->channel_layout;
   ret = av_frame_get_buffer(frame, 0);
@@ -138,31 +186,43 @@ bool exportSrc(std::string path, source* expSource){
     std::cout << "failed to allocate frame buffer " << std::endl;
     free_export(avctx, output_format_context);
     av_frame_free(&frame);
-    av_packet_unref(pkt);
     return result;
   }
 
-  int frameSample;
-  float* frameSamples;
-  int channelIndex;
+  float* scratch[CHANNEL_COUNT];
+  for(int channelIndex=0;channelIndex<CHANNEL_COUNT;channelIndex++) scratch[channelIndex] = new float[frameSize];
 
   unsigned int sourceSample = 0;
-  unsigned int srcReadSample;
+  float reported = 0;
+  bool stopped = false;
   
   while(sourceSample < sourceLen){
+    if(cancelled != NULL && *cancelled){
+      stopped = true;
+      break;
+    }
     av_frame_make_writable(frame);
     frame->pts = sourceSample;
-    for(channelIndex=0;channelIndex<avctx->channels;channelIndex++){
-      frameSamples = (float*)frame->data[channelIndex];
-      for(frameSample=0;frameSample<avctx->frame_size;frameSample++){
-        srcReadSample = sourceSample + frameSample;
-        frameSamples[frameSample] = srcReadSample < sourceLen
-          ? expSource->channels[channelIndex][srcReadSample]
-          : 0;
-      }
-    }
+    /* pcm and flac take a short last frame, aac wants it padded */
+    int count = frameSize;
+    if(avctx->frame_size <= 0 || codec == EXPORT_FLAC) count = std::min(frameSize, (int)(sourceLen - sourceSample));
+    frame->nb_samples = count;
+    fill_export_frame(frame, avctx, expSource, sourceSample, count, scratch);
     encode_audio_frame(frame, output_format_context, avctx);
-    sourceSample += avctx->frame_size;
+    sourceSample += count;
+
+    float done = (float)sourceSample / sourceLen;
+    if(progress && done - reported >= EXPORT_PROGRESS_STEP){
+      progress(done);
+      reported = done;
+    }
+  }
+  for(int channelIndex=0;channelIndex<CHANNEL_COUNT;channelIndex++) delete [] scratch[channelIndex];
+
+  if(stopped){
+    av_frame_free(&frame);
+    free_export(avctx, output_format_context);
+    return result;
   }
   encode_audio_frame(NULL, output_format_context, avctx);
 
@@ -171,15 +231,34 @@ bool exportSrc(std::string path, source* expSource){
     std::cout << "failed to write trailer " << std::endl;
     free_export(avctx, output_format_context);
     av_frame_free(&frame);
-    av_packet_unref(pkt);
     return result;
   }
 
   av_frame_free(&frame);
-  av_packet_unref(pkt);
   avcodec_free_context(&avctx);
   avio_closep(&output_format_context->pb);
   avformat_free_context(output_format_context);
 
   return true;
 }
+
+static std::atomic<unsigned int> exportCount(0);
+
+bool exportSrc(
+  std::string path, 
+  source* expSource, 
+  int codec,
+  std::function<void(float)> progress,
+  std::atomic<bool>* cancelled,
+  int threads
+){
+  /* each job has its own temporary, so a cancelled one never touches a newer export of the same path */
+  std::string tempPath = path + "." + std::to_string(exportCount++) + ".part";
+  bool result = export_encode(tempPath, expSource, codec, progress, cancelled, threads);
+  if(result && !cache_replace(tempPath, path)){
+    std::cout << "couldn't move export to " << path << std::endl;
+    result = false;
+  }
+  if(!result) remove(tempPath.c_str());
+  return result;
+}
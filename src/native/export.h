@@ -1,6 +1,9 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <atomic>
+#include <functional>
+#include <cstdio>
 
 extern "C"{
   #include <libavcodec/avcodec.h>
@@ -10,6 +13,15 @@ extern "C"{
 
 #include "state.h"
 
+static int EXPORT_FRAME_SAMPLES = 4096; //frame size for codecs that take any
+static float EXPORT_PROGRESS_STEP = 0.01; //progress is reported at most this often
+
+/* aac is small for sharing, wav and flac are quick to write for caches */
+enum exportCodec {EXPORT_AAC, EXPORT_WAV, EXPORT_FLAC};
+
+/* codec from its name, aac if unknown */
+int export_codec(std::string name);
+
 void encode_audio_frame(
   AVFrame *frame,
   AVFormatContext *output_format_context,
@@ -18,4 +30,14 @@ void encode_audio_frame(
 
 void free_export(AVCodecContext* avctx, AVFormatContext* output_format_context);
 
-bool exportSrc(std::string path, source* expSource);
\ No newline at end of file
+/* encode the source to a temporary beside path and move it over path once complete, so a cancelled or 
+failed export leaves path as it was. threads is passed to the codec for encoders that can split their 
+work, 0 lets it choose */
+bool exportSrc(
+  std::string path, 
+  source* expSource, 
+  int codec = EXPORT_AAC,
+  std::function<void(float)> progress = NULL,
+  std::atomic<bool>* cancelled = NULL,
+  int threads = 0
+);
\ No newline at end of file
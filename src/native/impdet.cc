@@ -1,68 +1,105 @@
 #include "impdet.h"
 
-static unsigned int IMPDET_WINSIZE = 512;
-static unsigned int IMPDET_AVGLEN = 80;
-static int IMPDET_CUTOFF = 3000;
-
-std::vector<int> impulseDetect(float* source, int sourceLen){
-  Dsp::Filter* filter = new Dsp::FilterDesign<Dsp::RBJ::Design::HighPass, 1>();
-  Dsp::Params params;
-  params[0] = SAMPLE_RATE;
-  params[1] = IMPDET_CUTOFF; // cutoff frequency
-  params[2] = 1.25; // Q
-  filter->setParams(params);
+void stats_push(energyStats& stats, float value){
+  if(stats.count == stats.values.size()){
+    float oldest = stats.values[stats.head];
+    stats.sum -= oldest;
+    stats.sumSq -= (double)oldest * oldest;
+  }else stats.count++;
+  stats.values[stats.head] = value;
+  stats.sum += value;
+  stats.sumSq += (double)value * value;
+  stats.head = (stats.head + 1) % stats.values.size();
+}
 
+/* threshold window energies starting at window firstWin, keeping beats from fromWin on */
+std::vector<int> impulse_threshold(const float* energies, unsigned int count, unsigned int firstWin, unsigned int fromWin){
   std::vector<int> beats;  //output
-  unsigned int winCount = (sourceLen / IMPDET_WINSIZE) - 1;
-  std::list<float> lastMeans = { 1. };
+  energyStats stats = {};
+  stats.values.resize(IMPDET_AVGLEN);
+  stats_push(stats, 1.);
 
-  float* winBuffer = new float[IMPDET_WINSIZE];
-
-  float sampleValue;
-  unsigned int startSample;
-  unsigned int winSampleIndex;
   float energyAvg;
   float energyVar;
   float energy;
-  bool inBeat;
-
-  for(unsigned int winIndex=0;winIndex<winCount;winIndex++){
-    startSample = winIndex * IMPDET_WINSIZE;
-    energy = 0;
-
-    /* copy into buffer for filtering */
-    for(winSampleIndex=0;winSampleIndex<IMPDET_WINSIZE;winSampleIndex++)
-      winBuffer[winSampleIndex] = source[startSample + winSampleIndex];
-    
-    filter->process(IMPDET_WINSIZE, &winBuffer);
+  bool inBeat = false;
 
-    for(winSampleIndex=0;winSampleIndex<IMPDET_WINSIZE;winSampleIndex++){
-      sampleValue = winBuffer[winSampleIndex];
-      energy += sampleValue*sampleValue;
-    }
-    energy /= IMPDET_WINSIZE; 
-      
-    energyAvg = 0;
-    for(float v : lastMeans) energyAvg += v;
-    energyAvg /= lastMeans.size();
+  for(unsigned int i=0;i<count;i++){
+    unsigned int winIndex = firstWin + i;
+    energy = energies[i];
 
-    energyVar = 0;
-    for(float v : lastMeans) energyVar += std::pow(v-energyAvg,2);
-    energyVar /= lastMeans.size();
-
-    lastMeans.push_front(energy);
-    if(lastMeans.size() > IMPDET_AVGLEN) lastMeans.pop_back();
+    energyAvg = stats.sum / stats.count;
+    energyVar = std::max(stats.sumSq / stats.count - (double)energyAvg * energyAvg, 0.);
+    stats_push(stats, energy);
 
     if((energy/energyAvg) > ((-0.002*energyVar) + 1.7)){
       if(!inBeat){ //trigger on rising edge past threshold
         inBeat = true;
-        beats.push_back(winIndex * IMPDET_WINSIZE);
+        if(winIndex >= fromWin) beats.push_back(winIndex * IMPDET_WINSIZE);
       }
     }else if(inBeat) inBeat = false;
   }
+  return beats;
+}
+
+Dsp::Filter* impulse_filter(){
+  Dsp::Filter* filter = new Dsp::FilterDesign<Dsp::RBJ::Design::HighPass, 1>();
+  Dsp::Params params;
+  params[0] = SAMPLE_RATE;
+  params[1] = IMPDET_CUTOFF; // cutoff frequency
+  params[2] = 1.25; // Q
+  filter->setParams(params);
+  return filter;
+}
+
+/* detect over windows [fromWin, toWin), running from warmWin first so the
+  filter and stats match a pass from the start */
+std::vector<int> impulseDetectRange(
+  const void* source, 
+  int format, 
+  int sourceLen, 
+  unsigned int warmWin,
+  unsigned int fromWin, 
+  unsigned int toWin
+){
+  Dsp::Filter* filter = impulse_filter();
+  float* blockBuffer = new float[IMPDET_WINSIZE * IMPDET_BLOCK];
+  std::vector<float> energies;
+
+  for(unsigned int blockWin=warmWin;blockWin<toWin;blockWin+=IMPDET_BLOCK){
+    unsigned int blockWins = std::min(IMPDET_BLOCK, toWin - blockWin);
+    samples_read(source, format, sourceLen, blockWin * IMPDET_WINSIZE, blockWins * IMPDET_WINSIZE, blockBuffer);
+    filter->process(blockWins * IMPDET_WINSIZE, &blockBuffer);
+    for(unsigned int i=0;i<blockWins;i++)
+      energies.push_back(samples_energy(blockBuffer + i * IMPDET_WINSIZE, IMPDET_WINSIZE) / IMPDET_WINSIZE);
+  }
 
-  delete [] winBuffer;
+  delete [] blockBuffer;
   delete filter;
-  
+  return impulse_threshold(energies.data(), energies.size(), warmWin, fromWin);
+}
+
+std::vector<int> impulseDetectEnergies(const std::vector<float>& energies, int sourceLen){
+  int winCount = std::min((sourceLen / (int)IMPDET_WINSIZE) - 1, (int)energies.size());
+  if(winCount <= 0) return std::vector<int>();
+  return impulse_threshold(energies.data(), winCount, 0, 0);
+}
+
+std::vector<int> impulseDetect(const void* source, int format, int sourceLen, std::string key){
+  int winCount = (sourceLen / (int)IMPDET_WINSIZE) - 1;
+  if(winCount <= 0) return std::vector<int>();
+
+  unsigned int segmentCount = (winCount + IMPDET_SEGMENT - 1) / IMPDET_SEGMENT;
+  std::vector<std::vector<int>> segmentBeats(segmentCount);
+  pool_batch(key, 0, segmentCount, [&](unsigned int segment){
+    unsigned int fromWin = segment * IMPDET_SEGMENT;
+    unsigned int toWin = std::min(fromWin + IMPDET_SEGMENT, (unsigned int)winCount);
+    unsigned int warmWin = fromWin > IMPDET_WARMUP ? fromWin - IMPDET_WARMUP : 0;
+    segmentBeats[segment] = impulseDetectRange(source, format, sourceLen, warmWin, fromWin, toWin);
+  });
+
+  std::vector<int> beats;
+  for(unsigned int segment=0;segment<segmentCount;segment++)
+    beats.insert(beats.end(), segmentBeats[segment].begin(), segmentBeats[segment].end());
   return beats;
-}
\ No newline at end of file
+}
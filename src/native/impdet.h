@@ -1,8 +1,40 @@
 #include <vector>
-#include <list>
 #include <cmath>
+#include <atomic>
+#include <string>
+#include <algorithm>
 #include <DspFilters/Dsp.h>
 
 #include "constants.h"
+#include "samples.h"
+#include "pool.h"
 
-std::vector<int> impulseDetect(float* source, int sourceLen);
\ No newline at end of file
+#ifndef IMPDET_HEADER_H
+#define IMPDET_HEADER_H
+
+static unsigned int IMPDET_WINSIZE = 512;
+static unsigned int IMPDET_AVGLEN = 80;
+static int IMPDET_CUTOFF = 3000;
+static unsigned int IMPDET_BLOCK = 64; //windows read and filtered at a time
+static unsigned int IMPDET_SEGMENT = 4096; //windows per parallel segment
+static unsigned int IMPDET_WARMUP = IMPDET_AVGLEN + 16; //windows replayed before a segment to settle the filter and stats
+
+/* running mean and variance over the last IMPDET_AVGLEN window energies */
+typedef struct{
+  std::vector<float> values;
+  unsigned int head;
+  unsigned int count;
+  double sum;
+  double sumSq;
+} energyStats;
+
+/* the high pass used ahead of the window energies */
+Dsp::Filter* impulse_filter();
+
+/* segments run as one pool batch under key */
+std::vector<int> impulseDetect(const void* source, int format, int sourceLen, std::string key);
+
+/* same beats from window energies already computed in load analysis */
+std::vector<int> impulseDetectEnergies(const std::vector<float>& energies, int sourceLen);
+
+#endif
@@ -1,14 +1,179 @@
 #include "load.h"
 
+/* output constants */
+static const AVSampleFormat LOAD_OUT_FMT = AV_SAMPLE_FMT_FLTP;
+static const uint64_t LOAD_OUT_LAYOUT = AV_CH_LAYOUT_STEREO;
+
+loadSegment* allocateSegment(int size){
+  loadSegment* segment = new loadSegment{};
+  for(int channelIndex=0;channelIndex<CHANNEL_COUNT;channelIndex++)
+    segment->channels.push_back(new float[size]);
+  segment->size = size;
+  segment->used = 0;
+  return segment;
+}
+
+void freeSegment(loadSegment* segment){
+  for(unsigned int channelIndex=0;channelIndex<segment->channels.size();channelIndex++)
+    delete [] segment->channels[channelIndex];
+  delete segment;
+}
+
+bool initResampler(streamInfo* ainfo, AVFrame* aFrame){
+  /* guess the channel layout if the decoder didn't set one */
+  uint64_t inLayout = aFrame->channel_layout != 0
+    ? aFrame->channel_layout
+    : av_get_default_channel_layout(aFrame->channels);
+
+  ainfo->swr = swr_alloc_set_opts(
+    NULL,
+    LOAD_OUT_LAYOUT, // out_ch_layout
+    LOAD_OUT_FMT, // out_sample_fmt
+    SAMPLE_RATE, // out_sample_rate
+    inLayout, // in_ch_layout
+    (AVSampleFormat)aFrame->format, // in_sample_fmt
+    aFrame->sample_rate, // in_sample_rate
+    0, // log_offset
+    NULL
+  );
+  if(ainfo->swr == NULL || swr_init(ainfo->swr) < 0){
+    std::cout << "could not initalize resampler on #" << ainfo->streamIndex << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/* resample input straight onto the end of the stream's segment list,
+  input of NULL flushes whatever the resampler has buffered */
+int resampleInto(streamInfo* ainfo, const uint8_t** input, int inSamples){
+  int needed = swr_get_out_samples(ainfo->swr, inSamples);
+  if(needed <= 0) return 0;
+
+  loadSegment* segment = ainfo->segments.size() ? ainfo->segments.back() : NULL;
+  if(segment == NULL || segment->size - segment->used < needed){
+    segment = allocateSegment(std::max(LOAD_SEGMENT_SAMPLES, needed));
+    ainfo->segments.push_back(segment);
+  }
+
+  uint8_t* output[CHANNEL_COUNT];
+  for(int channelIndex=0;channelIndex<CHANNEL_COUNT;channelIndex++)
+    output[channelIndex] = (uint8_t*)(segment->channels[channelIndex] + segment->used);
+
+  int ret = swr_convert(ainfo->swr, output, segment->size - segment->used, input, inSamples);
+  if(ret < 0){
+    std::cout << "resampling error on #" << ainfo->streamIndex << std::endl;
+    return ret;
+  }
+  segment->used += ret;
+  ainfo->length += ret;
+  return ret;
+}
+
+/* send a packet (or NULL to drain) and resample every frame it produces */
+void decodePacket(streamInfo* ainfo, AVPacket* pkt, AVFrame* aFrame){
+  int ret = avcodec_send_packet(ainfo->aCodecContext, pkt);
+  if(ret < 0 && ret != AVERROR_EOF){
+    std::cout << "error sending packet to decoder on #" << ainfo->streamIndex << std::endl;
+    return;
+  }
+
+  while(!ainfo->failed){
+    ret = avcodec_receive_frame(ainfo->aCodecContext, aFrame);
+    if(ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break; //needs more input
+    else if (ret < 0) {
+      std::cout << "decoding error on #" << ainfo->streamIndex << std::endl;
+      ainfo->failed = true;
+      break;
+    }
+
+    /* on recieveing first frame */
+    if(ainfo->swr == NULL && !initResampler(ainfo, aFrame)) ainfo->failed = true;
+    else if(aFrame->nb_samples > 0){
+      ret = resampleInto(ainfo, (const uint8_t**)aFrame->extended_data, aFrame->nb_samples);
+      if(ret < 0) ainfo->failed = true;
+    }
+    av_frame_unref(aFrame);
+  }
+}
+
+/* hand a packet to a stream's decoder thread, waiting while its queue is full */
+void pushPacket(streamInfo* ainfo, AVPacket* pkt){
+  std::unique_lock<std::mutex> lock(ainfo->packetsLock);
+  ainfo->packetsChanged.wait(lock, [ainfo]{ return ainfo->packets.size() < LOAD_QUEUE_PACKETS; });
+  ainfo->packets.push_back(pkt);
+  ainfo->packetsChanged.notify_all();
+}
+
+/* next packet for the decoder thread, NULL once demuxing is done and the queue is empty */
+AVPacket* popPacket(streamInfo* ainfo){
+  std::unique_lock<std::mutex> lock(ainfo->packetsLock);
+  ainfo->packetsChanged.wait(lock, [ainfo]{ return ainfo->packets.size() || ainfo->demuxed; });
+  if(ainfo->packets.empty()) return NULL;
+  AVPacket* pkt = ainfo->packets.front();
+  ainfo->packets.pop_front();
+  ainfo->packetsChanged.notify_all();
+  return pkt;
+}
+
+void endPackets(streamInfo* ainfo){
+  std::lock_guard<std::mutex> lock(ainfo->packetsLock);
+  ainfo->demuxed = true;
+  ainfo->packetsChanged.notify_all();
+}
+
+bool isCancelled(std::atomic<bool>* cancelled){
+  return cancelled != NULL && *cancelled;
+}
+
+/* per stream decoder thread, keeps consuming after failure so the demuxer never blocks */
+void decodeStream(streamInfo* ainfo){
+  AVFrame *aFrame = av_frame_alloc();
+  AVPacket* pkt;
+  int ret = 0;
+
+  while((pkt = popPacket(ainfo)) != NULL){
+    if(!ainfo->failed && !isCancelled(ainfo->cancelled)) decodePacket(ainfo, pkt, aFrame);
+    av_packet_free(&pkt);
+  }
+
+  /* drain the decoder and then the resampler so no tail audio is lost */
+  if(!ainfo->failed && !isCancelled(ainfo->cancelled)){
+    decodePacket(ainfo, NULL, aFrame);
+    if(ainfo->swr != NULL){
+      while(!ainfo->failed && (ret = resampleInto(ainfo, NULL, 0)) > 0);
+      if(ret < 0) ainfo->failed = true;
+    }
+  }
+  av_frame_free(&aFrame);
+}
+
+void freeStreamInfo(streamInfo* ainfo){
+  avcodec_free_context(&ainfo->aCodecContext);
+  swr_free(&ainfo->swr);
+  for(unsigned int i=0;i<ainfo->segments.size();i++) freeSegment(ainfo->segments[i]);
+  for(unsigned int i=0;i<ainfo->packets.size();i++) av_packet_free(&ainfo->packets[i]);
+  delete ainfo;
+}
+
+std::string loadKey(std::string path, int format){
+  struct stat info;
+  if(stat(path.c_str(), &info) != 0) return "";
+  return path + "|" + std::to_string((long long)info.st_mtime) + 
+    "|" + std::to_string((long long)info.st_size) + "|" + std::to_string(format);
+}
+
 void loadSrc(
   std::string path,
   std::string sourceId,
-  std::vector<loadResponse *> &loadedSources
+  std::vector<loadResponse *> &loadedSources,
+  int format,
+  std::atomic<bool>* cancelled
 ){
   int ret;
   AVFormatContext *pFormatCtx = NULL;
 
   /* open file */
+  if(isCancelled(cancelled)) return;
   ret = avformat_open_input(&pFormatCtx, path.c_str(), NULL, 0);
   if(ret < 0){
     std::cout << "could not open input " << std::endl;
@@ -19,220 +184,129 @@ void loadSrc(
   ret = avformat_find_stream_info(pFormatCtx, NULL);
    if(ret < 0){
     std::cout << "could not find stream info " << std::endl;
+    avformat_close_input(&pFormatCtx);
     return;
   }
 
   if(REPSYS_LOG) av_dump_format(pFormatCtx, 0, path.c_str(), 0);
 
+  /* split the cores between the audio streams for codecs that can thread internally */
+  unsigned int audioStreams = 0;
+  for(unsigned int i=0; i<pFormatCtx->nb_streams; i++)
+    if(pFormatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) audioStreams++;
+  int codecThreads = audioStreams ? std::max(1u, std::thread::hardware_concurrency() / audioStreams) : 1;
+
   std::vector<streamInfo *> streamInfos;
   for(unsigned int i=0; i<pFormatCtx->nb_streams; i++){
     if(pFormatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO){
       streamInfo * ainfo = new streamInfo{};
       ainfo->streamIndex = i;
-      ainfo->streamOutput = NULL;
+      ainfo->aCodecContext = NULL;
+      ainfo->swr = NULL;
+      ainfo->length = 0;
+      ainfo->demuxed = false;
+      ainfo->cancelled = cancelled;
       ainfo->failed = false;
 
-      /* stream length in samples based on timebase */
-      ainfo->streamLength = pFormatCtx->streams[i]->time_base.num/(float)pFormatCtx->streams[i]->time_base.den 
-        * pFormatCtx->streams[i]->duration; //in samples
-      
       AVCodecParameters* aCodecParameters = pFormatCtx->streams[i]->codecpar;
       ainfo->aCodec = avcodec_find_decoder(aCodecParameters->codec_id);
       if(!ainfo->aCodec){
         std::cout << "failed to find codec on #" << i << std::endl;
-        ainfo->failed = true;
+        freeStreamInfo(ainfo);
         continue;
       }
 
       ainfo->aCodecContext = avcodec_alloc_context3(ainfo->aCodec);
       if(avcodec_parameters_to_context(ainfo->aCodecContext, aCodecParameters) != 0){
         std::cout << "failed to copy codec params on #" << i << std::endl;
-        ainfo->failed = true;
+        freeStreamInfo(ainfo);
         continue;
       }
 
       /* guess the channel layout if it is missing */
       if(ainfo->aCodecContext->channel_layout == 0)
         ainfo->aCodecContext->channel_layout = av_get_default_channel_layout(ainfo->aCodecContext->channels);
-      
+
+      if(ainfo->aCodec->capabilities & (AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS)){
+        ainfo->aCodecContext->thread_count = codecThreads;
+        ainfo->aCodecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+      }
+
       if(avcodec_open2(ainfo->aCodecContext, ainfo->aCodec, NULL) < 0){
         std::cout << "failed to copy codec params on #" << i << std::endl;
-        ainfo->failed = true;
+        freeStreamInfo(ainfo);
         continue;
       }
       streamInfos.push_back(ainfo);
     }
   }
 
-  AVPacket* pkt = av_packet_alloc();
-  AVFrame *aFrame = av_frame_alloc();
-
-  int lineSize;
-  int channelIndex;
   unsigned int aStreamIndex;
-  int totalSamples = 0;
-
   streamInfo * ainfo;
-  while (av_read_frame(pFormatCtx, pkt) >= 0) {
+
+  /* one decoder + resampler thread per stream, fed by the demuxer below */
+  std::vector<std::thread> decoders;
+  for(aStreamIndex=0;aStreamIndex<streamInfos.size();aStreamIndex++)
+    decoders.push_back(std::thread(decodeStream, streamInfos[aStreamIndex]));
+
+  AVPacket* pkt = av_packet_alloc();
+  while (!isCancelled(cancelled) && av_read_frame(pFormatCtx, pkt) >= 0) {
     for(aStreamIndex=0;aStreamIndex<streamInfos.size();aStreamIndex++){
       ainfo = streamInfos[aStreamIndex];
-
-      if(!ainfo->failed && ainfo->streamIndex == pkt->stream_index){
-        /* send packet to decoder context */
-        ret = avcodec_send_packet(ainfo->aCodecContext, pkt);
-        if(ret < 0){
-          std::cout << "error sending packet to decoder on #" << aStreamIndex << std::endl;
-        }
-
-        /* get raw data frame from decoder */
-        ret = avcodec_receive_frame(ainfo->aCodecContext, aFrame);
-        if(ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) continue; //file error. just skip
-        else if (ret < 0) {
-          std::cout << "decoding error on #" << aStreamIndex << std::endl;
-          ainfo->failed = true;
-          continue;
-        }
-
-        /* on recieveing first frame */ 
-        if(ainfo->streamOutput == NULL){ 
-          ainfo->aFormat = (AVSampleFormat)aFrame->format;
-          ainfo->isPlanar = av_sample_fmt_is_planar(ainfo->aFormat);
-          ainfo->aRate = aFrame->sample_rate;
-          ainfo->aLayout = aFrame->channel_layout;
-          ainfo->dataSize = av_get_bytes_per_sample(ainfo->aFormat);
-          ainfo->channels = aFrame->channels;
-          ainfo->outputSize = 0;
-          ret = av_samples_alloc_array_and_samples(
-            &ainfo->streamOutput,
-            &lineSize,
-            aFrame->channels,
-            ainfo->aRate * ainfo->streamLength * 1.1,
-            ainfo->aFormat,
-            0
-          );
-          if(ret < 0){
-            std::cout << "could not allocate sample buffer for " << aStreamIndex << std::endl;
-            ainfo->failed = true;
-            continue;
-          }
-        }
-        totalSamples += aFrame->nb_samples;
-        if(totalSamples < ainfo->aRate * ainfo->streamLength){
-          /* copy data from frame to buffer */
-          if(aFrame->nb_samples > 0){
-            /* planar audio has a separate array for each channel */
-            if(ainfo->isPlanar){
-              for(channelIndex=0;channelIndex<aFrame->channels;channelIndex++){ 
-                memcpy(
-                  ainfo->streamOutput[channelIndex] + ainfo->outputSize,
-                  aFrame->data[channelIndex],
-                  ainfo->dataSize * aFrame->nb_samples
-                );
-              }
-              ainfo->outputSize += ainfo->dataSize * aFrame->nb_samples;
-            }else{
-              /* non planar audio is interleaved */
-              memcpy(
-                ainfo->streamOutput[0] + ainfo->outputSize,
-                aFrame->data[0],
-                ainfo->dataSize * aFrame->nb_samples * aFrame->channels
-              );
-              ainfo->outputSize += ainfo->dataSize * aFrame->nb_samples * aFrame->channels;
-            }
-          }
-        }
-        av_packet_unref(pkt);
+      if(ainfo->streamIndex == pkt->stream_index){
+        AVPacket* streamPkt = av_packet_alloc();
+        av_packet_move_ref(streamPkt, pkt);
+        pushPacket(ainfo, streamPkt);
+        break;
       }
     }
+    av_packet_unref(pkt);
   }
-  av_frame_free(&aFrame);
   av_packet_free(&pkt);
   avformat_close_input(&pFormatCtx);
-  
-  /* output constants */
-  int outRate = 44100;
-  int outChannels = 2;
-  AVSampleFormat outFmt = AV_SAMPLE_FMT_FLTP;
-  uint64_t outLayout = AV_CH_LAYOUT_STEREO;
-
-  int streamSamples;
-  int resampledSamples;
+
+  for(aStreamIndex=0;aStreamIndex<streamInfos.size();aStreamIndex++)
+    endPackets(streamInfos[aStreamIndex]);
+  for(unsigned int i=0;i<decoders.size();i++) decoders[i].join();
+
   for(aStreamIndex=0;aStreamIndex<streamInfos.size();aStreamIndex++){
     ainfo = streamInfos[aStreamIndex];
-    if(ainfo->failed) continue; //failed some point earlier
-
-    uint8_t **resampledOutput = NULL;
-    streamSamples = ainfo->outputSize / ainfo->dataSize;
-    if(!ainfo->isPlanar) streamSamples /= ainfo->channels; //planar is interleaved
-    resampledSamples = av_rescale_rnd(streamSamples, outRate, ainfo->aRate, AV_ROUND_UP);
-
-    ret = av_samples_alloc_array_and_samples(
-      &resampledOutput,
-      &lineSize,
-      outChannels, //channels
-      resampledSamples,
-      outFmt, //floatingpoint
-      0
-    );
-    if(ret < 0){
-      std::cout << "could not allocate resampling buffer for " << aStreamIndex << std::endl;
-      continue;
-    }
+    if(ainfo->failed || ainfo->length == 0 || isCancelled(cancelled)) continue; //failed some point earlier
 
-    /* setup resampler */
-    SwrContext *swr = swr_alloc_set_opts(
-      NULL, 
-      outLayout, // out_ch_layout
-      outFmt, // out_sample_fmt
-      outRate, // out_sample_rate
-      ainfo->aLayout, // in_ch_layout
-      ainfo->aFormat, // in_sample_fmt
-      ainfo->aRate, // in_sample_rate
-      0, // log_offset
-      NULL
-    );   
-    ret = swr_init(swr);    
-    if(ret < 0){
-      std::cout << "could not initalize resampler " << std::endl;
-      continue;
-    }
-    
-    /* run the resampler */
-    ret = swr_convert(
-      swr,
-      resampledOutput,
-      resampledSamples,
-      (const uint8_t **)ainfo->streamOutput,
-      streamSamples
-    );
-
-    swr_free(&swr); //free if it worked or not
-
-    if(ret < 0){
-      std::cout << "resampling error" << std::endl;
-      continue;
-    }
-    
     //success! add source
     std::string sourceTrackId = sourceId + (aStreamIndex > 0?":"+std::to_string(aStreamIndex):"");
     loadResponse* res = new loadResponse{};
-    res->length = resampledSamples;
+    res->length = ainfo->length;
     res->sourceId = sourceTrackId;
-    for(int i=0;i<outChannels;i++){
-      // float* resampled = (float*)resampledOutput[i];
-      // float * channel = new float[res->length];
-      // for(int s=0;s<res->length;s++) channel[s] = resampled[s];
-      res->channels.push_back((float*)resampledOutput[i]);
+    res->format = format;
+    for(int i=0;i<CHANNEL_COUNT;i++) res->channels.push_back(samples_new(res->length, format));
+
+    /* join segments into contiguous channels in the storage format, freeing each as we go.
+      analysis sees each segment while it's still float and in cache */
+    std::vector<Analyzer*> analyzers = analyzers_new();
+    int offset = 0;
+    for(unsigned int i=0;i<ainfo->segments.size();i++){
+      loadSegment* segment = ainfo->segments[i];
+      for(unsigned int a=0;a<analyzers.size();a++)
+        analyzers[a]->process(segment->channels.data(), segment->used);
+      for(int channelIndex=0;channelIndex<CHANNEL_COUNT;channelIndex++){
+        samples_encode(
+          segment->channels[channelIndex],
+          res->channels[channelIndex],
+          offset,
+          segment->used,
+          format
+        );
+      }
+      offset += segment->used;
+      freeSegment(segment);
     }
-    res->data = resampledOutput;
+    ainfo->segments.clear();
+    res->analysis = analyzers_finish(analyzers, res->length);
     loadedSources.push_back(res);
-  }  
+  }
 
   /* free all streamInfos */
-  for(aStreamIndex=0;aStreamIndex<streamInfos.size();aStreamIndex++){
-    avcodec_free_context(&streamInfos[aStreamIndex]->aCodecContext);
-    av_freep(&streamInfos[aStreamIndex]->streamOutput[0]);
-    av_freep(&streamInfos[aStreamIndex]->streamOutput);
-    delete streamInfos[aStreamIndex];
-  }
+  for(aStreamIndex=0;aStreamIndex<streamInfos.size();aStreamIndex++)
+    freeStreamInfo(streamInfos[aStreamIndex]);
 }
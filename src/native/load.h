@@ -1,6 +1,14 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <sys/stat.h>
 
 extern "C"{
   #include <libavcodec/avcodec.h>
@@ -10,31 +18,45 @@ extern "C"{
 
 #include "state.h"
 
+static int LOAD_SEGMENT_SAMPLES = 44100*10;
+static unsigned int LOAD_QUEUE_PACKETS = 64;
+
+typedef struct{
+  std::vector<float*> channels;
+  int size;
+  int used;
+} loadSegment;
+
 typedef struct{
   int streamIndex;
   AVCodec* aCodec;
   AVCodecContext* aCodecContext;
-  uint8_t **streamOutput;
-  float streamLength;
-  int outputSize;
-  int dataSize;
-  AVSampleFormat aFormat;
-  int aRate;
-  uint64_t aLayout;
-  int isPlanar;
-  int channels;
+  SwrContext* swr;
+  std::deque<AVPacket*> packets;
+  std::mutex packetsLock;
+  std::condition_variable packetsChanged;
+  bool demuxed;
+  std::atomic<bool>* cancelled;
+  std::vector<loadSegment*> segments;
+  int length;
   bool failed;
 } streamInfo;
 
 typedef struct{
   std::string sourceId;
-  std::vector<float*>  channels;
-  uint8_t ** data;
+  std::vector<void*>  channels;
+  int format;
   int length;
+  sourceAnalysis* analysis;
 } loadResponse;
 
+/* identifies a decoded file for sharing, empty if the file can't be stat'd */
+std::string loadKey(std::string path, int format);
+
 void loadSrc(
   std::string path,
   std::string sourceId,
-  std::vector<loadResponse *> &loadedSources
+  std::vector<loadResponse *> &loadedSources,
+  int format = SAMPLE_FLOAT32,
+  std::atomic<bool>* cancelled = NULL
 );
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef PARAMS_HEADER_H
+#define PARAMS_HEADER_H
+
+/* ids for the scalar parameters setParams takes in bulk, mirrored in src/render/util/params.ts.
+anything structural, chunks, sources and next playbacks, still goes through the object apis */
+static const int PARAMS_GLOBAL = -1; //target for the global playback rather than a track
+
+enum playbackParam {
+  PARAM_VOLUME,
+  PARAM_TIME,
+  PARAM_PLAYING,
+  PARAM_PERIOD
+};
+
+enum trackParam {
+  TRACK_PARAM_CHUNK_INDEX,
+  TRACK_PARAM_ALPHA,
+  TRACK_PARAM_VOLUME,
+  TRACK_PARAM_PLAYING,
+  TRACK_PARAM_LOOP,
+  TRACK_PARAM_MUTED,
+  TRACK_PARAM_FILTER,
+  TRACK_PARAM_DELAY,
+  TRACK_PARAM_DELAY_GAIN,
+  TRACK_PARAM_APERIODIC,
+  TRACK_PARAM_PRESERVE_PITCH,
+  TRACK_PARAM_PREVIEW,
+  TRACK_PARAM_NEXT_AT_CHUNK,
+  TRACK_PARAM_UNPAUSE
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "pool.h"
+
+typedef struct{
+  std::function<void(unsigned int)> run;
+  unsigned int count;
+  std::atomic<unsigned int> next;
+  unsigned int done;
+  std::mutex lock;
+  std::condition_variable finished;
+} poolBatch;
+
+static std::mutex poolLock;
+static std::condition_variable poolChanged;
+static std::vector<poolJob*> queuedJobs;
+static std::vector<poolJob*> runningJobs;
+static unsigned int workerCount = 0;
+static unsigned int targetWorkers = 0;
+static unsigned int jobOrder = 0;
+
+void pool_worker(){
+  std::unique_lock<std::mutex> lock(poolLock);
+  while(true){
+    poolChanged.wait(lock, []{ return queuedJobs.size() || workerCount > targetWorkers; });
+    if(workerCount > targetWorkers){ //pool shrunk
+      workerCount--;
+      return;
+    }
+
+    /* highest priority first, then first come first served */
+    unsigned int next = 0;
+    for(unsigned int i=1;i<queuedJobs.size();i++){
+      if(
+        queuedJobs[i]->priority > queuedJobs[next]->priority ||
+        (queuedJobs[i]->priority == queuedJobs[next]->priority && queuedJobs[i]->order < queuedJobs[next]->order)
+      ) next = i;
+    }
+    poolJob* job = queuedJobs[next];
+    queuedJobs.erase(queuedJobs.begin() + next);
+    runningJobs.push_back(job);
+
+    lock.unlock();
+    job->run(job);
+    lock.lock();
+
+    runningJobs.erase(std::find(runningJobs.begin(), runningJobs.end(), job));
+    delete job;
+  }
+}
+
+/* must hold poolLock */
+void pool_spawn(){
+  while(workerCount < targetWorkers){
+    workerCount++;
+    std::thread(pool_worker).detach();
+  }
+  poolChanged.notify_all();
+}
+
+/* first use sizes the pool to half the cores, must hold poolLock */
+void pool_start(){
+  if(targetWorkers == 0){
+    targetWorkers = std::max(1u, std::thread::hardware_concurrency() / 2);
+    pool_spawn();
+  }
+}
+
+void pool_resize(unsigned int size){
+  std::lock_guard<std::mutex> lock(poolLock);
+  targetWorkers = std::max(1u, size);
+  pool_spawn();
+}
+
+void pool_queue(std::string key, int priority, std::function<void(poolJob*)> run){
+  poolJob* job = new poolJob{};
+  job->key = key;
+  job->priority = priority;
+  job->cancelled = false;
+  job->run = run;
+
+  std::lock_guard<std::mutex> lock(poolLock);
+  pool_start();
+  job->order = jobOrder++;
+  queuedJobs.push_back(job);
+  poolChanged.notify_one();
+}
+
+void pool_cancel(std::string key){
+  std::lock_guard<std::mutex> lock(poolLock);
+  for(unsigned int i=0;i<queuedJobs.size();i++)
+    if(queuedJobs[i]->key == key) queuedJobs[i]->cancelled = true;
+  for(unsigned int i=0;i<runningJobs.size();i++)
+    if(runningJobs[i]->key == key) runningJobs[i]->cancelled = true;
+}
+
+unsigned int pool_size(){
+  std::lock_guard<std::mutex> lock(poolLock);
+  pool_start();
+  return targetWorkers;
+}
+
+/* claim items until none are left, jobs that start late find nothing and return */
+void pool_batch_work(std::shared_ptr<poolBatch> batch){
+  for(unsigned int i=batch->next++;i<batch->count;i=batch->next++){
+    batch->run(i);
+    std::lock_guard<std::mutex> lock(batch->lock);
+    if(++batch->done == batch->count) batch->finished.notify_all();
+  }
+}
+
+void pool_batch(std::string key, int priority, unsigned int count, std::function<void(unsigned int)> run){
+  if(count == 0) return;
+  std::shared_ptr<poolBatch> batch = std::make_shared<poolBatch>();
+  batch->run = run;
+  batch->count = count;
+  batch->next = 0;
+  batch->done = 0;
+
+  unsigned int helpers = std::min(count - 1, pool_size());
+  for(unsigned int i=0;i<helpers;i++)
+    pool_queue(key, priority, [batch](poolJob* job){ pool_batch_work(batch); });
+  pool_batch_work(batch);
+
+  std::unique_lock<std::mutex> lock(batch->lock);
+  batch->finished.wait(lock, [&batch]{ return batch->done == batch->count; });
+}
@@ -0,0 +1,36 @@
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#ifndef POOL_HEADER_H
+#define POOL_HEADER_H
+
+typedef struct poolJob{
+  std::string key;
+  int priority;
+  unsigned int order;
+  std::atomic<bool> cancelled;
+  std::function<void(poolJob*)> run;
+} poolJob;
+
+/* engine worker pool, sized to half the cores until resized */
+void pool_resize(unsigned int size);
+
+/* run a job on the pool, higher priority first. cancelled jobs still run so they can report back */
+void pool_queue(std::string key, int priority, std::function<void(poolJob*)> run);
+
+void pool_cancel(std::string key);
+
+unsigned int pool_size();
+
+/* run count items across the pool and the calling thread, returns once all are done.
+   the caller works too, so it can't starve even when called from a pool job */
+void pool_batch(std::string key, int priority, unsigned int count, std::function<void(unsigned int)> run);
+
+#endif
\ No newline at end of file
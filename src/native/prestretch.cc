@@ -0,0 +1,98 @@
+#include "prestretch.h"
+
+bool prestretch_render(
+  float** in,
+  std::vector<int> chunkLengths,
+  double chunkOut,
+  int chunkFrames,
+  float** out,
+  std::atomic<bool>* cancelled
+){
+  int chunkCount = chunkLengths.size();
+  size_t loopIn = 0;
+  for(int k=0;k<chunkCount;k++) loopIn += chunkLengths[k];
+  size_t totalIn = loopIn * PRESTRETCH_COPIES;
+  size_t totalOut = ceil(chunkOut * chunkCount * PRESTRETCH_COPIES);
+
+  /* made, reconfigured and freed under the plan lock, it plans through fftw like the live stretchers */
+  std::unique_lock<std::mutex> planning(spectrum_plan_lock());
+  RubberBand::RubberBandStretcher* stretcher = new RubberBand::RubberBandStretcher(
+    SAMPLE_RATE,
+    CHANNEL_COUNT,
+    RubberBand::RubberBandStretcher::OptionProcessOffline |
+    RubberBand::RubberBandStretcher::OptionTransientsCrisp |
+    RubberBand::RubberBandStretcher::OptionPhaseLaminar |
+    RubberBand::RubberBandStretcher::OptionFormantPreserved,
+    (double)totalOut / totalIn,
+    1.0
+  );
+  stretcher->setExpectedInputDuration(totalIn);
+  stretcher->setMaxProcessSize(PRESTRETCH_BLOCK);
+
+  /* chunks differ in length but all come out the same, pin each one's start */
+  std::map<size_t, size_t> keyFrames;
+  size_t inPosition = 0;
+  for(int copy=0;copy<PRESTRETCH_COPIES;copy++)
+    for(int k=0;k<chunkCount;k++){
+      keyFrames[inPosition] = round((copy * chunkCount + k) * chunkOut);
+      inPosition += chunkLengths[k];
+    }
+  stretcher->setKeyFrameMap(keyFrames);
+  planning.unlock();
+
+  float* block[CHANNEL_COUNT];
+  float* result[CHANNEL_COUNT];
+  for(int c=0;c<CHANNEL_COUNT;c++){
+    block[c] = new float[PRESTRETCH_BLOCK];
+    result[c] = new float[totalOut]();
+  }
+  size_t resultLength = 0;
+  bool done = true;
+
+  /* study the whole input, then stretch it, the copies are read round the one loop */
+  for(int pass=0;pass<2 && done;pass++){
+    for(size_t position=0;position<totalIn;position+=PRESTRETCH_BLOCK){
+      if(cancelled != NULL && *cancelled){
+        done = false;
+        break;
+      }
+      size_t count = std::min((size_t)PRESTRETCH_BLOCK, totalIn - position);
+      for(int c=0;c<CHANNEL_COUNT;c++)
+        for(size_t i=0;i<count;i++) block[c][i] = in[c][(position + i) % loopIn];
+      bool final = position + count >= totalIn;
+      if(pass == 0){
+        stretcher->study(block, count, final);
+        continue;
+      }
+      /* the first block after studying reconfigures for the stretch it worked out */
+      if(position == 0) planning.lock();
+      stretcher->process(block, count, final);
+      if(position == 0) planning.unlock();
+      int available;
+      while((available = stretcher->available()) > 0){
+        size_t take = std::min((size_t)available, (size_t)PRESTRETCH_BLOCK);
+        float* to[CHANNEL_COUNT];
+        bool fits = resultLength + take <= totalOut;
+        for(int c=0;c<CHANNEL_COUNT;c++) to[c] = fits ? result[c] + resultLength : block[c];
+        stretcher->retrieve(to, take);
+        if(fits) resultLength += take;
+      }
+    }
+  }
+
+  if(done)
+    for(int k=0;k<chunkCount;k++){
+      size_t start = round((chunkCount + k) * chunkOut);
+      for(int c=0;c<CHANNEL_COUNT;c++)
+        for(int i=0;i<chunkFrames;i++)
+          out[c][(size_t)k * chunkFrames + i] = start + i < resultLength ? result[c][start + i] : 0;
+    }
+
+  for(int c=0;c<CHANNEL_COUNT;c++){
+    delete [] block[c];
+    delete [] result[c];
+  }
+  planning.lock();
+  delete stretcher;
+  return done;
+}
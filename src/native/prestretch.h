@@ -0,0 +1,31 @@
+#include <vector>
+#include <map>
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+#include <rubberband/RubberBandStretcher.h>
+
+#include "constants.h"
+#include "spectrum.h"
+
+#ifndef PRESTRETCH_HEADER_H
+#define PRESTRETCH_HEADER_H
+
+static int PRESTRETCH_STABLE = 2; //checks a loop has to stay the same through before it's rendered
+static int PRESTRETCH_MAX = SAMPLE_RATE * 30; //longest loop rendered, in output frames
+static int PRESTRETCH_BLOCK = 4096; //frames given to the offline stretcher at once
+static int PRESTRETCH_COPIES = 3; //the middle copy is kept, its neighbours make the wrap seamless
+
+/* stretch a loop of chunks with rubberband's offline mode, pitch preserved. in is CHANNEL_COUNT buffers
+holding the chunks back to back, each chunk comes out chunkOut frames long. out gets chunkFrames per
+chunk, chunk by chunk. false if cancelled */
+bool prestretch_render(
+  float** in,
+  std::vector<int> chunkLengths,
+  double chunkOut,
+  int chunkFrames,
+  float** out,
+  std::atomic<bool>* cancelled = NULL
+);
+
+#endif
@@ -12,4 +12,31 @@ void allocateChunk(recording* recording){
   newChunk->bounds = new int[REC_CHUNK_BOUNDS];
   newChunk->boundsCount = 0;
   recording->chunks.push_back(newChunk);
+}
+
+void updateRecordingPyramid(recording* recording){
+  int base = recording->pyramid->base;
+  int fromBin = recording->pyramidLength / base;
+  int toBin = recording->length / base;
+  if(toBin <= fromBin) return;
+
+  /* gather whole bins, they may straddle chunks */
+  int count = (toBin - fromBin) * base;
+  float* samples = new float[count];
+  int sampleIndex = fromBin * base;
+  int copied = 0;
+  while(copied < count){
+    int chunkOffset = sampleIndex % REC_CHUNK_SAMPLES;
+    int span = std::min(count - copied, REC_CHUNK_SAMPLES - chunkOffset);
+    float* channel = recording->chunks[sampleIndex / REC_CHUNK_SAMPLES]->channels[0];
+    std::copy(channel + chunkOffset, channel + chunkOffset + span, samples + copied);
+    copied += span;
+    sampleIndex += span;
+  }
+
+  pyramid_resize(recording->pyramid, toBin);
+  pyramid_fill(recording->pyramid, samples, fromBin, toBin);
+  pyramid_reduce(recording->pyramid, fromBin, toBin);
+  recording->pyramidLength = toBin * base;
+  delete [] samples;
 }
\ No newline at end of file
@@ -3,5 +3,9 @@
 static int REC_CHUNK_SAMPLES = 44100*10;
 static int REC_CHUNK_BOUNDS = 100;
 static float REC_REALLOC_THRESH = 0.8;
+static int REC_POLL_MS = 30;
 
-void allocateChunk(recording* recording);
\ No newline at end of file
+void allocateChunk(recording* recording);
+
+/* bin any newly recorded samples into the recording's pyramid */
+void updateRecordingPyramid(recording* recording);
\ No newline at end of file
@@ -21,6 +21,21 @@ void ringbuffer_clear(ringbuffer* buf){
   buf->tail = 0;
 }
 
+int ringbuffer_available(ringbuffer* buf){
+  if(buf->head >= buf->tail) return buf->head - buf->tail;
+  else return buf->head + (buf->size - buf->tail);
+}
+
+void ringbuffer_read(ringbuffer* buf, float** dest, int count){
+  int first = std::min(count, buf->size - buf->tail);
+  for(int i=0;i<CHANNEL_COUNT;i++){
+    float* channel = buf->channels[i];
+    std::copy(channel + buf->tail, channel + buf->tail + first, dest[i]);
+    std::copy(channel, channel + count - first, dest[i] + first);
+  }
+  buf->tail = (buf->tail + count) % buf->size;
+}
+
 void ringbuffer_delete(ringbuffer* buf){
   for(int i=0;i<CHANNEL_COUNT;i++){
     delete [] buf->channels[i];
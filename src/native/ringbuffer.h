@@ -1,4 +1,5 @@
 #include <vector>
+#include <algorithm>
 
 #include "constants.h"
 
@@ -16,6 +17,12 @@ ringbuffer* ringbuffer_new(int size);
 
 void ringbuffer_clear(ringbuffer* buf);
 
+/* frames between tail and head */
+int ringbuffer_available(ringbuffer* buf);
+
+/* copy count frames out from the tail and advance it, a span at a time either side of the wrap */
+void ringbuffer_read(ringbuffer* buf, float** dest, int count);
+
 void ringbuffer_delete(ringbuffer* buf);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,254 @@
+#include "samples.h"
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <immintrin.h>
+  #define SAMPLES_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+  #define SAMPLES_NEON
+#endif
+
+/* f16c comes with avx, which not every x86 machine has. the half kernels are built for it on their own
+rather than the whole addon, and only taken when the cpu has it */
+#if defined(SAMPLES_SSE2) && (defined(__GNUC__) || defined(__clang__))
+  #define SAMPLES_F16C
+  #define SAMPLES_F16C_TARGET __attribute__((target("avx,f16c")))
+#elif defined(SAMPLES_SSE2) && defined(_MSC_VER)
+  #include <intrin.h>
+  #define SAMPLES_F16C
+  #define SAMPLES_F16C_TARGET
+#endif
+
+#if defined(SAMPLES_F16C)
+static bool samples_cpu_f16c(){
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 1);
+  bool osSaves = (info[2] >> 27) & 1, avx = (info[2] >> 28) & 1, f16c = (info[2] >> 29) & 1;
+  return osSaves && avx && f16c && (_xgetbv(0) & 6) == 6;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+#endif
+}
+
+static const bool samplesF16C = samples_cpu_f16c();
+
+/* both return how many were done, the rest is left to the scalar tail */
+static SAMPLES_F16C_TARGET int samples_decode_f16c(const uint16_t* src, float* dest, int count){
+  int i = 0;
+  for(;i+8<=count;i+=8)
+    _mm256_storeu_ps(dest + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+  return i;
+}
+
+static SAMPLES_F16C_TARGET int samples_encode_f16c(const float* src, uint16_t* dest, int count){
+  const __m256 max = _mm256_set1_ps(65504.f), min = _mm256_set1_ps(-65504.f);
+  int i = 0;
+  for(;i+8<=count;i+=8){
+    __m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), min), max); //clamp to max finite
+    _mm_storeu_si128((__m128i*)(dest + i), _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+  }
+  return i;
+}
+#endif
+
+int samples_format(std::string name){
+  if(name == "int16") return SAMPLE_INT16;
+  else if(name == "float16") return SAMPLE_FLOAT16;
+  else return SAMPLE_FLOAT32;
+}
+
+void* samples_new(int length, int format){
+  if(format == SAMPLE_INT16) return new int16_t[length];
+  else if(format == SAMPLE_FLOAT16) return new uint16_t[length];
+  else return new float[length];
+}
+
+void samples_delete(void* samples, int format){
+  if(format == SAMPLE_INT16) delete [] (int16_t*)samples;
+  else if(format == SAMPLE_FLOAT16) delete [] (uint16_t*)samples;
+  else delete [] (float*)samples;
+}
+
+uint16_t samples_float_to_half(float value){
+  uint16_t sign = value < 0 ? 0x8000 : 0;
+  /* half subnormals would be float subnormals below, rounding twice. they're whole steps of 2^-24 */
+  if(fabsf(value) < 6.103515625e-05f) return sign | (uint16_t)lrintf(fabsf(value) * 16777216.f); //2^-14, 2^24
+  float scaled = fabsf(value) * 1.925929944387236e-34f; //2^-112
+  uint32_t bits;
+  memcpy(&bits, &scaled, sizeof(float));
+  uint32_t half = (bits + 0x0fff + ((bits >> 13) & 1)) >> 13; //round to nearest even
+  if(half > 0x7bff) half = 0x7bff; //clamp to max finite
+  return sign | half;
+}
+
+void samples_encode_int16(const float* src, int16_t* dest, int count){
+  int i = 0;
+#if defined(SAMPLES_SSE2)
+  const __m128 vscale = _mm_set1_ps(32768.f), max = _mm_set1_ps(32767.f), min = _mm_set1_ps(-32768.f);
+  for(;i+8<=count;i+=8){
+    __m128 lo = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), vscale), min), max);
+    __m128 hi = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), vscale), min), max);
+    _mm_storeu_si128((__m128i*)(dest + i), _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi)));
+  }
+#elif defined(SAMPLES_NEON)
+  for(;i+8<=count;i+=8){
+    int32x4_t lo = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(src + i), 32768.f));
+    int32x4_t hi = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(src + i + 4), 32768.f));
+    vst1q_s16(dest + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+  }
+#endif
+  float value;
+  for(;i<count;i++){
+    value = src[i] * 32768.f;
+    if(value > 32767.f) value = 32767.f;
+    if(value < -32768.f) value = -32768.f;
+    dest[i] = (int16_t)lrintf(value);
+  }
+}
+
+void samples_encode_float16(const float* src, uint16_t* dest, int count){
+  int i = 0;
+#if defined(SAMPLES_F16C)
+  if(samplesF16C) i = samples_encode_f16c(src, dest, count);
+#elif defined(SAMPLES_NEON)
+  const float32x4_t max = vdupq_n_f32(65504.f), min = vdupq_n_f32(-65504.f);
+  for(;i+4<=count;i+=4)
+    vst1_u16(dest + i, vreinterpret_u16_f16(vcvt_f16_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i), min), max))));
+#endif
+  for(;i<count;i++) dest[i] = samples_float_to_half(src[i]);
+}
+
+void samples_encode(const float* src, void* samples, int offset, int count, int format){
+  if(format == SAMPLE_INT16) samples_encode_int16(src, (int16_t*)samples + offset, count);
+  else if(format == SAMPLE_FLOAT16) samples_encode_float16(src, (uint16_t*)samples + offset, count);
+  else memcpy((float*)samples + offset, src, count * sizeof(float));
+}
+
+void samples_decode_int16(const int16_t* src, float* dest, int count){
+  const float scale = 1.f / 32768.f;
+  int i = 0;
+#if defined(SAMPLES_SSE2)
+  const __m128 vscale = _mm_set1_ps(scale);
+  for(;i+8<=count;i+=8){
+    __m128i packed = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+    _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+    _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+  }
+#elif defined(SAMPLES_NEON)
+  for(;i+8<=count;i+=8){
+    int16x8_t packed = vld1q_s16(src + i);
+    vst1q_f32(dest + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(packed))), scale));
+    vst1q_f32(dest + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(packed))), scale));
+  }
+#endif
+  for(;i<count;i++) dest[i] = src[i] * scale;
+}
+
+void samples_decode_float16(const uint16_t* src, float* dest, int count){
+  int i = 0;
+#if defined(SAMPLES_F16C)
+  if(samplesF16C) i = samples_decode_f16c(src, dest, count);
+#elif defined(SAMPLES_NEON)
+  for(;i+4<=count;i+=4)
+    vst1q_f32(dest + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+#endif
+  for(;i<count;i++) dest[i] = samples_half_to_float(src[i]);
+}
+
+void samples_read(const void* samples, int format, int length, int start, int count, float* dest){
+  /* zero pad anything outside the source */
+  int lead = start < 0 ? std::min(-start, count) : 0;
+  int end = std::max(std::min(start + count, length), start + lead);
+  int span = end - (start + lead);
+  for(int i=0;i<lead;i++) dest[i] = 0;
+  for(int i=lead+span;i<count;i++) dest[i] = 0;
+  if(span <= 0) return;
+
+  int from = start + lead;
+  float* to = dest + lead;
+  if(format == SAMPLE_INT16) samples_decode_int16((const int16_t*)samples + from, to, span);
+  else if(format == SAMPLE_FLOAT16) samples_decode_float16((const uint16_t*)samples + from, to, span);
+  else memcpy(to, (const float*)samples + from, span * sizeof(float));
+}
+
+float samples_energy(const float* samples, int count){
+  int i = 0;
+  float energy = 0;
+#if defined(SAMPLES_SSE2)
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  for(;i+8<=count;i+=8){
+    __m128 a = _mm_loadu_ps(samples + i);
+    __m128 b = _mm_loadu_ps(samples + i + 4);
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(a, a));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(b, b));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+  energy = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(SAMPLES_NEON)
+  float32x4_t acc0 = vdupq_n_f32(0);
+  float32x4_t acc1 = vdupq_n_f32(0);
+  for(;i+8<=count;i+=8){
+    float32x4_t a = vld1q_f32(samples + i);
+    float32x4_t b = vld1q_f32(samples + i + 4);
+    acc0 = vfmaq_f32(acc0, a, a);
+    acc1 = vfmaq_f32(acc1, b, b);
+  }
+  energy = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+  for(;i<count;i++) energy += samples[i] * samples[i];
+  return energy;
+}
+void samples_interleave(float* const* in, int channels, int count, float* out){
+  int i = 0;
+  if(channels == 2){
+    const float* left = in[0];
+    const float* right = in[1];
+#if defined(SAMPLES_SSE2)
+    for(;i+4<=count;i+=4){
+      __m128 l = _mm_loadu_ps(left + i);
+      __m128 r = _mm_loadu_ps(right + i);
+      _mm_storeu_ps(out + i*2, _mm_unpacklo_ps(l, r));
+      _mm_storeu_ps(out + i*2 + 4, _mm_unpackhi_ps(l, r));
+    }
+#elif defined(SAMPLES_NEON)
+    for(;i+4<=count;i+=4){
+      float32x4x2_t lr = {{vld1q_f32(left + i), vld1q_f32(right + i)}};
+      vst2q_f32(out + i*2, lr);
+    }
+#endif
+  }
+  for(;i<count;i++)
+    for(int c=0;c<channels;c++) out[i*channels + c] = in[c][i];
+}
+
+void samples_deinterleave(const float* in, int channels, int count, float* const* out){
+  int i = 0;
+  if(channels == 2){
+    float* left = out[0];
+    float* right = out[1];
+#if defined(SAMPLES_SSE2)
+    for(;i+4<=count;i+=4){
+      __m128 a = _mm_loadu_ps(in + i*2);
+      __m128 b = _mm_loadu_ps(in + i*2 + 4);
+      _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+      _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#elif defined(SAMPLES_NEON)
+    for(;i+4<=count;i+=4){
+      float32x4x2_t lr = vld2q_f32(in + i*2);
+      vst1q_f32(left + i, lr.val[0]);
+      vst1q_f32(right + i, lr.val[1]);
+    }
+#endif
+  }
+  for(;i<count;i++)
+    for(int c=0;c<channels;c++) out[c][i] = in[i*channels + c];
+}
@@ -0,0 +1,51 @@
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+#ifndef SAMPLES_HEADER_H
+#define SAMPLES_HEADER_H
+
+/* storage formats for source channels, everything is read back as float */
+enum sampleFormat {
+  SAMPLE_FLOAT32,
+  SAMPLE_INT16,
+  SAMPLE_FLOAT16
+};
+
+int samples_format(std::string name);
+
+void* samples_new(int length, int format);
+
+void samples_delete(void* samples, int format);
+
+/* convert count floats into samples starting at offset */
+void samples_encode(const float* src, void* samples, int offset, int count, int format);
+
+/* read count samples from start into dest as float, zero filling outside of [0, length) */
+void samples_read(const void* samples, int format, int length, int start, int count, float* dest);
+
+/* sum of squares of count floats */
+float samples_energy(const float* samples, int count);
+
+/* count frames of planar channels into one interleaved buffer */
+void samples_interleave(float* const* in, int channels, int count, float* out);
+
+/* count interleaved frames out into planar channels */
+void samples_deinterleave(const float* in, int channels, int count, float* const* out);
+
+static inline float samples_half_to_float(uint16_t h){
+  /* shift the half into float position, then rescale the exponent. exact for normals and subnormals */
+  uint32_t bits = (uint32_t)(h & 0x7fff) << 13;
+  float value;
+  memcpy(&value, &bits, sizeof(float));
+  value *= 5.192296858534828e+33f; //2^112
+  return (h & 0x8000) ? -value : value;
+}
+
+static inline float samples_get(const void* samples, int format, int index){
+  if(format == SAMPLE_INT16) return ((const int16_t*)samples)[index] * (1.f / 32768.f);
+  else if(format == SAMPLE_FLOAT16) return samples_half_to_float(((const uint16_t*)samples)[index]);
+  else return ((const float*)samples)[index];
+}
+
+#endif
\ No newline at end of file
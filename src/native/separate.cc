@@ -1,74 +1,263 @@
 #include "separate.h"
 
-static TF_Session * session;
-static TF_Output * input_op;
-static TF_Output * output_op;
-
-static int SOURCE_COUNT = 2;
-
-void init_separator(std::string rootPath){
-  //TF_Status* status = TF_NewStatus();
-  // TF_Buffer* run_options = TF_NewBufferFromString("", 0);
-  // TF_SessionOptions* options = TF_NewSessionOptions();
-  // const char* tags[] = {"serve"};
-
-  // TF_Graph* graph = TF_NewGraph();
-  // TF_Buffer* metagraph = TF_NewBuffer();
-  
-  // session = TF_LoadSessionFromSavedModel(
-  //   options,
-  //   run_options,
-  //   (rootPath + "lib/spleeter").c_str(),
-  //   tags,
-  //   1,
-  //   graph,
-  //   metagraph,
-  //   status
-  // );
-
-  // TF_DeleteStatus(status);
-  // TF_DeleteSessionOptions(options);
-  // TF_DeleteBuffer(run_options);
-
-  // input_op = new TF_Output{TF_GraphOperationByName(graph, "Placeholder"), 0};
-  // TF_Output* outputs = new TF_Output[SOURCE_COUNT];
-  // outputs[0] = TF_Output{TF_GraphOperationByName(graph, "strided_slice_13"), 0};
-  // outputs[1] = TF_Output{TF_GraphOperationByName(graph, "strided_slice_23"), 0};
-  // output_op = &outputs[0];
-}
-
-void separate(std::vector<float*>  channels, std::vector<float*>  outchannels, int length){
-  // std::size_t len = length*2*sizeof(float);
-  // int64_t* dims = new int64_t[2]{length, 2};
-  // TF_Tensor* input_tensor = TF_AllocateTensor(TF_FLOAT, dims, 2, len);
-  // float* data_in = static_cast<float*>(TF_TensorData(input_tensor));
-  // for(int i=0;i<length;i++){
-  //   data_in[i*2] = channels[0][i];
-  //   data_in[i*2+1] = channels[1][i];
-  // }
-  // TF_Tensor** output_tensor = new TF_Tensor*[2];
-  // TF_Status* status = TF_NewStatus();
-
-  // TF_SessionRun(
-  //   session,
-  //   nullptr,
-  //   input_op, &input_tensor, 1,
-  //   output_op, output_tensor, SOURCE_COUNT,
-  //   nullptr, 0,
-  //   nullptr,
-  //   status
-  // );
-
-  // float* data_out;
-  // for(int sourceIndex=0;sourceIndex<SOURCE_COUNT;sourceIndex++){
-  //   data_out = static_cast<float*>(TF_TensorData(output_tensor[sourceIndex]));
-  //   for(int i=0;i<length;i++){
-  //     outchannels[sourceIndex*SOURCE_COUNT][i] = data_out[i*2];
-  //     outchannels[sourceIndex*SOURCE_COUNT+1][i] = data_out[i*2+1];
-  //   }
-  //   TF_DeleteTensor(output_tensor[sourceIndex]);
-  // }
-
-  // TF_DeleteStatus(status);
-  // TF_DeleteTensor(input_tensor);
-}
\ No newline at end of file
+static SeparatorBackend* backend = NULL;
+
+ModelBackend::ModelBackend(TF_Session* session, TF_Output input, std::vector<TF_Output> outputs):
+  session(session), input(input), outputs(outputs){}
+
+bool ModelBackend::process(float** in, int length, float** out){
+  int64_t dims[2] = {length, CHANNEL_COUNT};
+  TF_Tensor* inputTensor = TF_AllocateTensor(TF_FLOAT, dims, 2, length * CHANNEL_COUNT * sizeof(float));
+  float* dataIn = static_cast<float*>(TF_TensorData(inputTensor));
+  for(int i=0;i<length;i++)
+    for(int c=0;c<CHANNEL_COUNT;c++) dataIn[i*CHANNEL_COUNT + c] = in[c][i];
+
+  std::vector<TF_Tensor*> outputTensors(SEPARATE_STEMS, NULL);
+  TF_Status* status = TF_NewStatus();
+  TF_SessionRun(
+    session,
+    nullptr,
+    &input, &inputTensor, 1,
+    outputs.data(), outputTensors.data(), SEPARATE_STEMS,
+    nullptr, 0,
+    nullptr,
+    status
+  );
+
+  bool ok = TF_GetCode(status) == TF_OK;
+  if(!ok) std::cout << "separation failed: " << TF_Message(status) << std::endl;
+  for(int stem=0;stem<SEPARATE_STEMS;stem++){
+    if(outputTensors[stem] == NULL) continue;
+    if(ok){
+      float* dataOut = static_cast<float*>(TF_TensorData(outputTensors[stem]));
+      for(int i=0;i<length;i++)
+        for(int c=0;c<CHANNEL_COUNT;c++) out[stem*CHANNEL_COUNT + c][i] = dataOut[i*CHANNEL_COUNT + c];
+    }
+    TF_DeleteTensor(outputTensors[stem]);
+  }
+
+  TF_DeleteStatus(status);
+  TF_DeleteTensor(inputTensor);
+  return ok;
+}
+
+size_t ModelBackend::memory(int length){
+  /* stft, masks and per-stem spectrograms dwarf the pcm */
+  return (size_t)length * CHANNEL_COUNT * sizeof(float) * 48;
+}
+
+std::string ModelBackend::version(){
+  return "spleeter-2stems";
+}
+
+bool CenterBackend::process(float** in, int length, float** out){
+  float* vocal[2] = {out[0], out[1]};
+  float* instru[2] = {out[2], out[3]};
+  for(int i=0;i<length;i++){
+    float mid = (in[0][i] + in[1][i]) * 0.5;
+    vocal[0][i] = mid;
+    vocal[1][i] = mid;
+    instru[0][i] = in[0][i] - mid;
+    instru[1][i] = in[1][i] - mid;
+  }
+  return true;
+}
+
+size_t CenterBackend::memory(int length){
+  return (size_t)length * CHANNEL_COUNT * sizeof(float) * (SEPARATE_STEMS + 1);
+}
+
+std::string CenterBackend::version(){
+  return "center-1";
+}
+
+void init_separator(std::string rootPath, std::string name){
+  if(name == "center"){
+    std::cout << "separating with the mid/side stand-in" << std::endl;
+    backend = new CenterBackend();
+    return;
+  }
+  std::string modelPath = rootPath + "lib/spleeter";
+  struct stat modelStat;
+  if(stat(modelPath.c_str(), &modelStat) == 0){
+    TF_Status* status = TF_NewStatus();
+    TF_Buffer* runOptions = TF_NewBufferFromString("", 0);
+    TF_SessionOptions* options = TF_NewSessionOptions();
+    const char* tags[] = {"serve"};
+
+    TF_Graph* graph = TF_NewGraph();
+    TF_Buffer* metagraph = TF_NewBuffer();
+
+    TF_Session* session = TF_LoadSessionFromSavedModel(
+      options,
+      runOptions,
+      modelPath.c_str(),
+      tags,
+      1,
+      graph,
+      metagraph,
+      status
+    );
+
+    if(TF_GetCode(status) == TF_OK){
+      TF_Output input = TF_Output{TF_GraphOperationByName(graph, "Placeholder"), 0};
+      std::vector<TF_Output> outputs;
+      outputs.push_back(TF_Output{TF_GraphOperationByName(graph, "strided_slice_13"), 0});
+      outputs.push_back(TF_Output{TF_GraphOperationByName(graph, "strided_slice_23"), 0});
+      /* a different export of the model names its ops differently */
+      bool found = input.oper != NULL;
+      for(unsigned int i=0;i<outputs.size();i++) found = found && outputs[i].oper != NULL;
+      if(found) backend = new ModelBackend(session, input, outputs);
+      else{
+        std::cout << "separation model is missing its input or output ops" << std::endl;
+        TF_CloseSession(session, status);
+        TF_DeleteSession(session, status);
+      }
+    }else std::cout << "couldn't load separation model: " << TF_Message(status) << std::endl;
+    if(backend == NULL) TF_DeleteGraph(graph);
+
+    TF_DeleteStatus(status);
+    TF_DeleteSessionOptions(options);
+    TF_DeleteBuffer(runOptions);
+    TF_DeleteBuffer(metagraph);
+  }else std::cout << "no separation model at " << modelPath << std::endl;
+}
+
+SeparatorBackend* separator_backend(){
+  return backend;
+}
+
+std::string separation_key(uint64_t hash, int format, int length){
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+  return std::string(hex) + "-" + std::to_string(format) + "-" + std::to_string(length) + "-" + separator_backend()->version();
+}
+
+int separation_segments(int length){
+  int hop = SEPARATE_SEGMENT - SEPARATE_OVERLAP;
+  return length > SEPARATE_OVERLAP ? (length - SEPARATE_OVERLAP + hop - 1) / hop : 1;
+}
+
+separationMarks* separation_new(int length, int from){
+  separationMarks* marks = new separationMarks{};
+  marks->length = length;
+  marks->segmentCount = separation_segments(length);
+  marks->first = std::min(std::max(from, 0) / (SEPARATE_SEGMENT - SEPARATE_OVERLAP), marks->segmentCount - 1);
+  marks->frontier = marks->first;
+  marks->to = marks->first * (SEPARATE_SEGMENT - SEPARATE_OVERLAP);
+  marks->done = new std::atomic<bool>[marks->segmentCount];
+  for(int i=0;i<marks->segmentCount;i++) marks->done[i] = false;
+  return marks;
+}
+
+void separation_delete(separationMarks* marks){
+  delete [] marks->done;
+  delete marks;
+}
+
+bool separation_ready(separationMarks* marks, int start, int count){
+  int hop = SEPARATE_SEGMENT - SEPARATE_OVERLAP;
+  int end = std::min(start + count, marks->length);
+  start = std::max(start, 0);
+  if(start >= end) return true;
+  /* segment i covers [i*hop, i*hop + SEPARATE_SEGMENT) */
+  int firstSegment = std::max(0, (start - SEPARATE_SEGMENT + hop) / hop);
+  int lastSegment = std::min((end - 1) / hop, marks->segmentCount - 1);
+  for(int i=firstSegment;i<=lastSegment;i++)
+    if(!marks->done[i].load(std::memory_order_acquire)) return false;
+  return true;
+}
+
+separationWork* separation_work_new(
+  std::vector<void*> channels, 
+  int format, 
+  std::vector<float*> outchannels, 
+  int length, 
+  separationMarks* marks
+){
+  separationWork* work = new separationWork{};
+  work->channels = channels;
+  work->format = format;
+  work->outchannels = outchannels;
+  work->length = length;
+  work->marks = marks;
+  work->seams = std::vector<std::mutex>(marks->segmentCount);
+  work->next = 0;
+  work->done = 0;
+  work->stopped = false;
+  return work;
+}
+
+void separation_work_delete(separationWork* work){
+  delete work;
+}
+
+unsigned int separation_lanes(separationWork* work, unsigned int most){
+  /* each job holds a segment and the backend's working set */
+  size_t segmentMemory = separator_backend()->memory(SEPARATE_SEGMENT) +
+    (size_t)SEPARATE_SEGMENT * (CHANNEL_COUNT + SEPARATE_STEMS * CHANNEL_COUNT) * sizeof(float);
+  unsigned int lanes = std::min(most, (unsigned int)std::max(SEPARATE_MEMORY / segmentMemory, (size_t)1));
+  return std::max(std::min(lanes, (unsigned int)work->marks->segmentCount), 1u);
+}
+
+void separation_run(separationWork* work, std::function<void(float, int)> progress, std::atomic<bool>* cancelled){
+  SeparatorBackend* separator = separator_backend();
+  separationMarks* marks = work->marks;
+  int hop = SEPARATE_SEGMENT - SEPARATE_OVERLAP;
+  int segmentCount = marks->segmentCount;
+  int outCount = SEPARATE_STEMS * CHANNEL_COUNT;
+  int length = work->length;
+
+  float* in[CHANNEL_COUNT];
+  for(int c=0;c<CHANNEL_COUNT;c++) in[c] = new float[SEPARATE_SEGMENT];
+  float** out = new float*[outCount];
+  for(int o=0;o<outCount;o++) out[o] = new float[SEPARATE_SEGMENT];
+
+  /* from the playhead to the end, then wrap round to the start */
+  for(int claimed=work->next++;claimed<segmentCount;claimed=work->next++){
+    if(cancelled != NULL && *cancelled) work->stopped = true;
+    if(work->stopped) break;
+    int segment = (marks->first + claimed) % segmentCount;
+    int start = segment * hop;
+    int count = std::min(SEPARATE_SEGMENT, length - start);
+    for(int c=0;c<CHANNEL_COUNT;c++) samples_read(work->channels[c], work->format, length, start, count, in[c]);
+    if(!separator->process(in, count, out)){
+      work->stopped = true;
+      break;
+    }
+
+    /* linear fades over the overlaps sum to one, the middle is copied as is */
+    int fadeIn = segment > 0 ? std::min(SEPARATE_OVERLAP, count) : 0;
+    int fadeOut = segment < segmentCount - 1 ? SEPARATE_OVERLAP : 0;
+    {
+      std::lock_guard<std::mutex> guard(work->seams[segment]);
+      for(int o=0;o<outCount;o++)
+        for(int i=0;i<fadeIn;i++) work->outchannels[o][start + i] += out[o][i] * (float)i / SEPARATE_OVERLAP;
+    }
+    for(int o=0;o<outCount;o++)
+      std::copy(out[o] + fadeIn, out[o] + count - fadeOut, work->outchannels[o] + start + fadeIn);
+    if(fadeOut){
+      std::lock_guard<std::mutex> guard(work->seams[segment + 1]);
+      int fadeStart = count - fadeOut;
+      for(int o=0;o<outCount;o++)
+        for(int i=0;i<fadeOut;i++)
+          work->outchannels[o][start + fadeStart + i] += out[o][fadeStart + i] * (1 - (float)i / SEPARATE_OVERLAP);
+    }
+
+    std::lock_guard<std::mutex> guard(work->progressLock);
+    marks->done[segment].store(true, std::memory_order_release);
+    while(marks->frontier < segmentCount && marks->done[marks->frontier]) marks->frontier++;
+    /* the overlap into an unfinished segment isn't final yet */
+    marks->to = marks->frontier < segmentCount ? marks->frontier * hop : length;
+    int segmentsDone = ++work->done;
+    if(progress) progress((float)segmentsDone / segmentCount, marks->to);
+  }
+
+  for(int c=0;c<CHANNEL_COUNT;c++) delete [] in[c];
+  for(int o=0;o<outCount;o++) delete [] out[o];
+  delete [] out;
+}
+
+bool separation_complete(separationWork* work){
+  return !work->stopped && work->done == work->marks->segmentCount;
+}
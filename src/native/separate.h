@@ -1,6 +1,124 @@
 #include <vector>
 #include <string>
-#include <tensorflow/c/c_api.h>       
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+#include <sys/stat.h>
+#include <tensorflow/c/c_api.h>
 
-void init_separator(std::string rootPath);
-void separate(std::vector<float*>  channels, std::vector<float*>  outchannels, int length);
\ No newline at end of file
+#include "constants.h"
+#include "samples.h"
+
+#ifndef SEPARATE_HEADER_H
+#define SEPARATE_HEADER_H
+
+static int SEPARATE_STEMS = 2; //vocal, instrumental
+static const char* SEPARATE_SUFFIXES[] = {"_vocal", "_instru"};
+static int SEPARATE_SEGMENT = 44100 * 20; //samples the model sees at once
+static int SEPARATE_OVERLAP = 44100; //crossfaded between neighbouring segments
+static size_t SEPARATE_MEMORY = (size_t)2048 * 1024 * 1024; //budget for segments in flight
+
+/* which segments of a separation in progress are final, shared with the audio callback. segments are 
+done in playback order so the stems fill in ahead of the playhead */
+typedef struct{
+  int length;
+  int segmentCount;
+  int first; //segment separated first, where the playhead was
+  int frontier; //next segment after first that isn't done yet
+  std::atomic<int> to; //samples from first's start onward that are final, the watermark
+  std::atomic<bool>* done;
+  int refs; //stems sharing these, only touched on the js thread
+} separationMarks;
+
+/* turns a stereo segment into SEPARATE_STEMS stereo stems, called from many threads at once */
+class SeparatorBackend {
+  public:
+    virtual ~SeparatorBackend(){}
+    /* in is CHANNEL_COUNT buffers, out is SEPARATE_STEMS*CHANNEL_COUNT, all of length */
+    virtual bool process(float** in, int length, float** out) = 0;
+    /* peak bytes used separating a segment of length */
+    virtual size_t memory(int length) = 0;
+    /* changes whenever the output would */
+    virtual std::string version() = 0;
+};
+
+/* spleeter saved model through the tensorflow c api */
+class ModelBackend: public SeparatorBackend {
+  public:
+    ModelBackend(TF_Session* session, TF_Output input, std::vector<TF_Output> outputs);
+    bool process(float** in, int length, float** out);
+    size_t memory(int length);
+    std::string version();
+  private:
+    TF_Session* session;
+    TF_Output input;
+    std::vector<TF_Output> outputs;
+};
+
+/* stand-in for tests without the model: the centre of the mix as vocal, the rest as instrumental. only
+ever used when asked for by name */
+class CenterBackend: public SeparatorBackend {
+  public:
+    bool process(float** in, int length, float** out);
+    size_t memory(int length);
+    std::string version();
+};
+
+/* loads the model under rootPath, or with name "center" the stand-in instead */
+void init_separator(std::string rootPath, std::string name = "model");
+
+/* NULL without a model unless the stand-in was asked for, separations fail rather than publish it */
+SeparatorBackend* separator_backend();
+
+/* names the stems of some content for the result cache, changes with the model. needs a backend */
+std::string separation_key(uint64_t hash, int format, int length);
+
+int separation_segments(int length);
+
+/* marks for a separation of length starting from the segment holding sample from */
+separationMarks* separation_new(int length, int from);
+
+void separation_delete(separationMarks* marks);
+
+/* whether every segment covering [start, start + count) is done, safe from any thread */
+bool separation_ready(separationMarks* marks, int start, int count);
+
+/* a separation of a whole source in overlapping segments, shared by the pool jobs working on it. 
+outchannels are zeroed, SEPARATE_STEMS*CHANNEL_COUNT of length. segments are taken in marks' order */
+typedef struct{
+  std::vector<void*> channels;
+  int format;
+  std::vector<float*> outchannels;
+  int length;
+  separationMarks* marks;
+  std::vector<std::mutex> seams; //neighbours both add into their shared overlap, one lock per seam
+  std::mutex progressLock;
+  std::atomic<int> next;
+  std::atomic<int> done;
+  std::atomic<bool> stopped; //cancelled or the backend failed, the other jobs stop too
+} separationWork;
+
+separationWork* separation_work_new(
+  std::vector<void*> channels, 
+  int format, 
+  std::vector<float*> outchannels, 
+  int length, 
+  separationMarks* marks
+);
+
+void separation_work_delete(separationWork* work);
+
+/* how many jobs can separate at once inside the memory budget, no more than most */
+unsigned int separation_lanes(separationWork* work, unsigned int most);
+
+/* separate segments until none are left, run from several pool jobs at once. segments are marked as 
+they finish and progress gets the fraction done and the watermark */
+void separation_run(separationWork* work, std::function<void(float, int)> progress, std::atomic<bool>* cancelled);
+
+/* every segment separated, once all the jobs are done */
+bool separation_complete(separationWork* work);
+
+#endif
@@ -0,0 +1,204 @@
+#include "spectrum.h"
+
+static std::mutex planLock;
+static std::map<std::pair<int, int>, fftw_plan> plans;
+static std::map<int, double*> windows;
+static std::string wisdomPath;
+
+std::mutex& spectrum_plan_lock(){
+  return planLock;
+}
+
+void spectrum_wisdom(std::string path){
+  std::lock_guard<std::mutex> lock(planLock);
+  wisdomPath = path;
+  fftw_import_wisdom_from_filename(path.c_str());
+}
+
+fftw_plan spectrum_plan(int size, int batch){
+  std::lock_guard<std::mutex> lock(planLock);
+  fftw_plan& plan = plans[std::make_pair(size, batch)];
+  if(plan == NULL){
+    int bins = size / 2 + 1;
+    double* in = fftw_alloc_real(size * batch);
+    fftw_complex* out = fftw_alloc_complex(bins * batch);
+    plan = fftw_plan_many_dft_r2c(1, &size, batch, in, NULL, 1, size, out, NULL, 1, bins, FFTW_MEASURE);
+    fftw_free(in);
+    fftw_free(out);
+    if(wisdomPath.size()) fftw_export_wisdom_to_filename(wisdomPath.c_str());
+  }
+  return plan;
+}
+
+fftw_plan spectrum_plan_r2c(int size, double* in, fftw_complex* out){
+  std::lock_guard<std::mutex> lock(planLock);
+  return fftw_plan_dft_r2c_1d(size, in, out, FFTW_ESTIMATE);
+}
+
+fftw_plan spectrum_plan_c2r(int size, fftw_complex* in, double* out){
+  std::lock_guard<std::mutex> lock(planLock);
+  return fftw_plan_dft_c2r_1d(size, in, out, FFTW_ESTIMATE);
+}
+
+void spectrum_destroy_plan(fftw_plan plan){
+  std::lock_guard<std::mutex> lock(planLock);
+  fftw_destroy_plan(plan);
+}
+
+const double* spectrum_window(int size){
+  std::lock_guard<std::mutex> lock(planLock);
+  double*& window = windows[size];
+  if(window == NULL){
+    window = new double[size];
+    for(int i=0;i<size;i++) window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / size);
+  }
+  return window;
+}
+
+spectrumBuilder* spectrum_builder_new(){
+  spectrumBuilder* builder = new spectrumBuilder{};
+  int size = SPECTRUM_WINDOW;
+  int bins = size / 2 + 1;
+  builder->base = PYRAMID_BASE;
+  builder->plan = spectrum_plan(size, SPECTRUM_BATCH);
+  builder->window = spectrum_window(size);
+  builder->in = fftw_alloc_real(size * SPECTRUM_BATCH);
+  builder->out = fftw_alloc_complex(bins * SPECTRUM_BATCH);
+
+  /* fft bins belonging to each band, dc is skipped */
+  builder->edges[0] = 1;
+  for(int band=1;band<SPECTRUM_BANDS;band++)
+    builder->edges[band] = round(SPECTRUM_SPLITS[band-1] * size / SAMPLE_RATE);
+  builder->edges[SPECTRUM_BANDS] = bins;
+
+  /* one-sided spectrum power back to time domain energy over a bin */
+  double windowPower = 0;
+  for(int i=0;i<size;i++) windowPower += builder->window[i] * builder->window[i];
+  builder->norm = 2. * builder->base / (size * windowPower);
+
+  /* each frame is centered on its bin, so the first window starts before the source */
+  builder->pending.assign(size / 2 - builder->base / 2, 0);
+  return builder;
+}
+
+/* run count frames from the front of pending */
+void spectrum_frames(spectrumBuilder* builder, int count){
+  int size = SPECTRUM_WINDOW;
+  int bins = size / 2 + 1;
+  int base = builder->base;
+  for(int f=0;f<SPECTRUM_BATCH;f++){
+    double* frameIn = builder->in + f * size;
+    float* frameBlock = builder->pending.data() + builder->consumed + f * base;
+    for(int i=0;i<size;i++) frameIn[i] = f < count ? frameBlock[i] * builder->window[i] : 0;
+  }
+  fftw_execute_dft_r2c(builder->plan, builder->in, builder->out);
+
+  for(int f=0;f<count;f++){
+    fftw_complex* frameOut = builder->out + f * bins;
+    for(int band=0;band<SPECTRUM_BANDS;band++){
+      double energy = 0;
+      for(int bin=builder->edges[band];bin<builder->edges[band+1];bin++)
+        energy += frameOut[bin][0] * frameOut[bin][0] + frameOut[bin][1] * frameOut[bin][1];
+      builder->energies.push_back(energy * builder->norm);
+    }
+  }
+  builder->consumed += count * base;
+}
+
+void spectrum_builder_push(spectrumBuilder* builder, const float* samples, int count){
+  builder->pending.insert(builder->pending.end(), samples, samples + count);
+  int batchLen = SPECTRUM_WINDOW + (SPECTRUM_BATCH - 1) * builder->base;
+  while((int)builder->pending.size() - builder->consumed >= batchLen)
+    spectrum_frames(builder, SPECTRUM_BATCH);
+  builder->pending.erase(builder->pending.begin(), builder->pending.begin() + builder->consumed);
+  builder->consumed = 0;
+}
+
+spectrumPyramid* spectrum_builder_finish(spectrumBuilder* builder, int sourceLen){
+  int base = builder->base;
+  int frames = std::max((sourceLen + base - 1) / base, 1);
+  int done = builder->energies.size() / SPECTRUM_BANDS;
+
+  /* zero pad past the end for the last windows */
+  int needed = (frames - done - 1) * base + SPECTRUM_WINDOW;
+  if((int)builder->pending.size() < needed) builder->pending.resize(needed, 0);
+  while(done < frames){
+    int count = std::min(SPECTRUM_BATCH, frames - done);
+    spectrum_frames(builder, count);
+    done += count;
+  }
+
+  spectrumPyramid* spectrum = new spectrumPyramid{};
+  spectrum->base = base;
+  float* energies = new float[frames * SPECTRUM_BANDS];
+  std::copy(builder->energies.begin(), builder->energies.begin() + frames * SPECTRUM_BANDS, energies);
+  spectrum->levels.push_back(energies);
+  spectrum->lengths.push_back(frames);
+  while(spectrum->lengths.back() > 1){
+    float* child = spectrum->levels.back();
+    int childLength = spectrum->lengths.back();
+    int length = (childLength + 1) / 2;
+    float* level = new float[length * SPECTRUM_BANDS];
+    for(int bin=0;bin<length;bin++){
+      int left = bin * 2;
+      for(int band=0;band<SPECTRUM_BANDS;band++){
+        level[bin * SPECTRUM_BANDS + band] = child[left * SPECTRUM_BANDS + band] + 
+          (left + 1 < childLength ? child[(left + 1) * SPECTRUM_BANDS + band] : 0);
+      }
+    }
+    spectrum->levels.push_back(level);
+    spectrum->lengths.push_back(length);
+  }
+
+  fftw_free(builder->in);
+  fftw_free(builder->out);
+  delete builder;
+  return spectrum;
+}
+
+void spectrum_delete(spectrumPyramid* spectrum){
+  for(unsigned int i=0;i<spectrum->levels.size();i++) delete [] spectrum->levels[i];
+  delete spectrum;
+}
+
+void spectrumWaveform(
+  spectrumPyramid* spectrum,
+  float scale,
+  int start,
+  int sourceLen,
+  float* dest,
+  int destLen,
+  float vscale
+){
+  int width = destLen / SPECTRUM_BANDS;
+  int base = spectrum->base;
+  int binCount = spectrum->lengths[0];
+  double energy[SPECTRUM_BANDS];
+
+  for(int i=0;i<width;i++){
+    int startBin = round((i*scale + start) / base);
+    int endBin = round(((i+1)*scale + start) / base);
+    endBin = std::max(endBin, startBin + 1); //zoomed in past a bin, repeat it
+    startBin = std::max(startBin, 0);
+    endBin = std::min(endBin, std::min(binCount, (sourceLen + base - 1) / base));
+    int binsUsed = endBin - startBin;
+
+    for(int band=0;band<SPECTRUM_BANDS;band++) energy[band] = 0;
+    for(unsigned int levelIndex=0;startBin<endBin && levelIndex<spectrum->levels.size();levelIndex++){
+      float* level = spectrum->levels[levelIndex];
+      if(startBin & 1){
+        for(int band=0;band<SPECTRUM_BANDS;band++) energy[band] += level[startBin * SPECTRUM_BANDS + band];
+        startBin++;
+      }
+      if(endBin & 1){
+        endBin--;
+        for(int band=0;band<SPECTRUM_BANDS;band++) energy[band] += level[endBin * SPECTRUM_BANDS + band];
+      }
+      startBin /= 2;
+      endBin /= 2;
+    }
+
+    for(int band=0;band<SPECTRUM_BANDS;band++)
+      dest[i * SPECTRUM_BANDS + band] = binsUsed > 0 ? sqrt(energy[band] / (binsUsed * base)) * vscale : 0;
+  }
+}
@@ -0,0 +1,81 @@
+#include <vector>
+#include <string>
+#include <mutex>
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include <fftw3.h>
+
+#include "constants.h"
+#include "samples.h"
+#include "waveform.h"
+
+#ifndef SPECTRUM_HEADER_H
+#define SPECTRUM_HEADER_H
+
+static const int SPECTRUM_BANDS = 3; //low, mid, high
+static int SPECTRUM_WINDOW = 1024; //fft size, frames hop one pyramid bin
+static int SPECTRUM_BATCH = 64; //frames per fftw call
+static double SPECTRUM_SPLITS[SPECTRUM_BANDS - 1] = {250, 4000}; //hz between bands
+
+/* band energies per pyramid bin, each level halves the one below */
+typedef struct{
+  std::vector<float*> levels; //SPECTRUM_BANDS energies per bin, interleaved
+  std::vector<int> lengths;
+  int base;
+} spectrumPyramid;
+
+/* the fftw planner isn't thread safe. anything that makes or destroys plans holds this, rubberband
+stretchers included since they plan through fftw too */
+std::mutex& spectrum_plan_lock();
+
+/* import fftw wisdom from path, newly measured plans are saved back to it */
+void spectrum_wisdom(std::string path);
+
+/* shared batched r2c plan, measured on first use. run it with fftw_execute_dft_r2c
+  on fftw_alloc'd buffers */
+fftw_plan spectrum_plan(int size, int batch);
+
+/* one off plans, these hold the plan lock */
+fftw_plan spectrum_plan_r2c(int size, double* in, fftw_complex* out);
+fftw_plan spectrum_plan_c2r(int size, fftw_complex* in, double* out);
+void spectrum_destroy_plan(fftw_plan plan);
+
+/* periodic hann window of size, shared */
+const double* spectrum_window(int size);
+
+/* streams one channel in, frames are computed as soon as their window is filled */
+typedef struct{
+  std::vector<float> pending; //samples from the next frame's window start
+  int consumed; //pending samples already behind the next window
+  std::vector<float> energies;
+  int base;
+  int edges[SPECTRUM_BANDS + 1]; //fft bins per band
+  double norm;
+  fftw_plan plan;
+  const double* window;
+  double* in;
+  fftw_complex* out;
+} spectrumBuilder;
+
+spectrumBuilder* spectrum_builder_new();
+
+void spectrum_builder_push(spectrumBuilder* builder, const float* samples, int count);
+
+/* pad out the last frames and free the builder */
+spectrumPyramid* spectrum_builder_finish(spectrumBuilder* builder, int sourceLen);
+
+void spectrum_delete(spectrumPyramid* spectrum);
+
+/* SPECTRUM_BANDS rms amplitudes per pixel, pixel edges snap to bins */
+void spectrumWaveform(
+  spectrumPyramid* spectrum,
+  float scale,
+  int start,
+  int sourceLen,
+  float* dest,
+  int destLen,
+  float vscale
+);
+
+#endif
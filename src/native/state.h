@@ -12,6 +12,15 @@
 #include "constants.h"
 #include "stretcher.h"
 #include "ringbuffer.h"
+#include "samples.h"
+#include "waveform.h"
+#include "analysis.h"
+#include "separate.h"
+#include "cache.h"
+#include "timing.h"
+#include "events.h"
+#include "automation.h"
+#include "prestretch.h"
 
 #ifndef STATE_HEADER_H
 #define STATE_HEADER_H
@@ -49,6 +58,57 @@ typedef struct{
   bool preview;
 } mixTrackPlayback;
 
+/* a second pipeline that warms up a next playback due at the phase wrap, so it takes over on the wrap's
+frame already running instead of refilling from nothing. swapped with the track's own when it does */
+typedef struct{
+  mixTrackPlayback* playback; //the next playback being warmed, NULL if none
+  double sample; //source position read up to
+  int chunkIndex; //chunk sample is in, when warming the track's own playback
+  int switchFrame; //frame in the current buffer it takes over at, -1 if it doesn't
+  bool used; //needs a reset before warming anything else
+  PVStretcher* pvstretcher;
+  REStretcher* restretcher;
+  ringbuffer* inputBuffer;
+  Dsp::Filter* filter;
+} mixTrackPreroll;
+
+/* what a prestretched loop was rendered from, it's only read while the track still looks like this */
+typedef struct{
+  std::string sourceId;
+  mixTrackSourceConfig* params;
+  float volume;
+  int offset;
+} prestretchSource;
+
+typedef struct{
+  mixTrackPlayback* playback;
+  std::vector<int> chunks;
+  float alpha;
+  int period;
+  std::vector<prestretchSource> sources;
+} prestretchConfig;
+
+/* a static loop stretched offline at higher quality than the live stretchers manage, read instead of
+them while the config holds. freed like tracks, removed then safe */
+typedef struct{
+  prestretchConfig config;
+  std::vector<float*> channels; //chunkFrames per chunk, chunk by chunk
+  double chunkOut; //frames a chunk lasts at the config's period and alpha
+  int chunkFrames;
+  bool removed;
+  bool safe;
+} prestretchLoop;
+
+/* a track rendered down to one source, which it plays in place of its own playback until thawed */
+typedef struct{
+  std::string sourceId;
+  mixTrackPlayback* playback; //the track's own, js updates still land here
+  mixTrackPlayback* frozen; //plays the source
+  mixTrackPlayback* rendered; //what was rendered, changing any of that thaws the track
+  bool removed; //thawed, freed like tracks once safe
+  bool safe;
+} mixTrackFreeze;
+
 typedef struct{
   mixTrackPlayback* playback;
   mixTrackPlayback* nextPlayback;
@@ -61,6 +121,10 @@ typedef struct{
   bool removed;
   bool safe;
   float gain;
+  float level; //decaying output peak, for meters
+  int timingSlot; //where the track is published in the timing snapshot, -1 for none
+  trackAutomation* automation;
+  float* automationGain; //volume and playing automation for the current buffer
   ringbuffer *delayBuffer;
   PVStretcher* pvstretcher;
   REStretcher* restretcher;
@@ -68,14 +132,41 @@ typedef struct{
   float** stretchInput;
   float** stretchOutput;
   Dsp::Filter* filter;
+  mixTrackPreroll* preroll;
+  prestretchLoop* prestretch; //NULL until one is rendered, js thread only sets it
+  prestretchConfig prestretchSeen; //config at the last check, js thread only
+  int prestretchStable; //checks it's stayed the same through
+  bool prestretching; //a render is in flight
+  bool prestretchActive; //the callback is reading the loop rather than the stretchers
+  double prestretchPhase; //phase of the last frame read from it
+  bool prestretchLeaving; //the loop plays on while the preroll warms the live pipeline to take over
+  int prestretchLeft; //frames the loop has played since leaving began
+  mixTrackFreeze* freeze; //NULL unless frozen
+  bool swapped; //playback was replaced from js, the stretchers hold the old one
 } mixTrack;
 
+/* decoded file shared by every source loaded from it, freed once refs hits zero */
+typedef struct{
+  std::string key;
+  std::vector<std::string> suffixes;
+  std::vector<std::vector<void*>> streams;
+  std::vector<int> lengths;
+  std::vector<sourceAnalysis*> analyses;
+  std::vector<cacheMapping*> mappings; //streams mapped from cache files instead of decoded
+  int format;
+  int refs;
+} sourceBuffer;
+
 typedef struct{
-  std::vector<float*> channels;
+  std::vector<void*> channels;
+  int format;
   int length;
-  uint8_t ** data;
+  sourceBuffer* buffer;
+  sourceAnalysis* analysis;
+  separationMarks* separating; //set on stems still being separated, kept until the source is freed
   bool removed;
   bool safe;
+  int readers; //async jobs still reading, only touched on the js thread
 } source;
 
 typedef struct{
@@ -94,6 +185,8 @@ typedef struct{
   std::vector<recordChunk*> chunks;
   unsigned int chunkIndex;
   int length;
+  waveformPyramid* pyramid; //channel 0, updated by the poller
+  int pyramidLength; //samples covered by the pyramid
 } recording;
 
 typedef struct{
@@ -101,10 +194,14 @@ typedef struct{
   bool previewing;
   float* window;
   unsigned int windowSize;
+  float* readBuffer;
+  int sourceFormat;
   playback *playback;
   std::unordered_map<std::string, mixTrack*> mixTracks;
   std::unordered_map<std::string, source*> sources;
+  std::unordered_map<std::string, sourceBuffer*> buffers;
   recording* recording;
+  bool offline; //rendered away from the device, publishes no timing or events
 } streamState;
 
 #endif
\ No newline at end of file
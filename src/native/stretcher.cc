@@ -1,40 +1,41 @@
 #include "stretcher.h"
 #include "ringbuffer.h"
+#include "spectrum.h"
 
 REStretcher::REStretcher(){
   int e;
   resampler = src_new(1, CHANNEL_COUNT, &e);
 
-  inputBuffer = new float[MAX_ALPHA*WINDOW_SIZE*2];
-  outputBuffer = new float[MAX_ALPHA*WINDOW_SIZE*2];
+  inputBuffer = new float[RESAMPLE_FRAMES*CHANNEL_COUNT];
+  outputBuffer = new float[RESAMPLE_FRAMES*CHANNEL_COUNT];
 
   data = new SRC_DATA{};
   data->end_of_input = 0;
   data->src_ratio = 1;
   data->data_in = inputBuffer;
   data->data_out = outputBuffer;
-  data->output_frames = WINDOW_SIZE * 16;
+  data->output_frames = RESAMPLE_FRAMES;
 
-  outputRing = ringbuffer_new(data->output_frames * 2);
+  outputRing = ringbuffer_new(WINDOW_SIZE * 32);
 }
 
 REStretcher::~REStretcher(){
   src_delete(resampler);
+  delete data;
   delete[] inputBuffer;
   delete[] outputBuffer;
   ringbuffer_delete(outputRing);
 }
 
 int REStretcher::getAvailable(){
-  if(outputRing->head >= outputRing->tail) return outputRing->head - outputRing->tail;
-  else return outputRing->head + (outputRing->size - outputRing->tail);
+  return ringbuffer_available(outputRing);
 }
 
 int REStretcher::getRequired(){
   return WINDOW_SIZE / data->src_ratio;
 }
 
-int REStretcher::getTimeRatio(){
+double REStretcher::getTimeRatio(){
   return data->src_ratio;
 }
 
@@ -51,33 +52,29 @@ void REStretcher::reset(){
 }
 
 void REStretcher::process(float **input, int samples){
-  float* head = inputBuffer;
-  for(int sample=0;sample<samples;sample++){
-    for(int c=0;c<CHANNEL_COUNT;c++){
-      *(head++) = input[c][sample];
-    }
-  }
-  data->input_frames = samples;
+  /* libsamplerate only takes interleaved frames */
+  samples_interleave(input, CHANNEL_COUNT, std::min(samples, RESAMPLE_FRAMES), inputBuffer);
+  data->input_frames = std::min(samples, RESAMPLE_FRAMES);
   src_process(resampler, data);
-  int channel = 0;
-  for(int os=0;os<data->output_frames_gen * CHANNEL_COUNT;os++){
-    outputRing->channels[channel][outputRing->head] = outputBuffer[os];
-    channel = (channel + 1) % CHANNEL_COUNT;
-    if(channel == 0) outputRing->head = (outputRing->head + 1) % outputRing->size;
-  }
+
+  /* straight into the ring, either side of its wrap */
+  int frames = data->output_frames_gen;
+  int first = std::min(frames, outputRing->size - outputRing->head);
+  float* dest[CHANNEL_COUNT];
+  for(int c=0;c<CHANNEL_COUNT;c++) dest[c] = outputRing->channels[c] + outputRing->head;
+  samples_deinterleave(outputBuffer, CHANNEL_COUNT, first, dest);
+  for(int c=0;c<CHANNEL_COUNT;c++) dest[c] = outputRing->channels[c];
+  samples_deinterleave(outputBuffer + first * CHANNEL_COUNT, CHANNEL_COUNT, frames - first, dest);
+  outputRing->head = (outputRing->head + frames) % outputRing->size;
 }
 
 void REStretcher::retrieve(float **output, int samples){
-  for(int sample=0;sample<samples;sample++){
-    for(int c=0;c<CHANNEL_COUNT;c++){
-      output[c][sample] = outputRing->channels[c][outputRing->tail];
-      outputRing->channels[c][outputRing->tail] = 0;
-    }
-    outputRing->tail = (outputRing->tail + 1) % outputRing->size;
-  }
+  /* slots are overwritten by process, never mixed into, so they're left as they are */
+  ringbuffer_read(outputRing, output, samples);
 }
 
 PVStretcher::PVStretcher(){
+  std::lock_guard<std::mutex> lock(spectrum_plan_lock());
   stretcher = new RubberBand::RubberBandStretcher(
     SAMPLE_RATE,
     CHANNEL_COUNT,
@@ -92,6 +89,11 @@ PVStretcher::PVStretcher(){
   stretcher->setFormantOption(RubberBand::RubberBandStretcher::OptionFormantPreserved);
 }
 
+PVStretcher::~PVStretcher(){
+  std::lock_guard<std::mutex> lock(spectrum_plan_lock());
+  delete stretcher;
+}
+
 int PVStretcher::getAvailable(){
   return stretcher->available();
 }
@@ -100,7 +102,7 @@ int PVStretcher::getRequired(){
   return stretcher->getSamplesRequired();
 }
 
-int PVStretcher::getTimeRatio(){
+double PVStretcher::getTimeRatio(){
   return stretcher->getTimeRatio();
 }
 
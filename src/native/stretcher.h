@@ -4,15 +4,18 @@
 
 #include "constants.h"
 #include "ringbuffer.h"
+#include "samples.h"
 
 #ifndef STRETCHER_HEADER_H
 #define STRETCHER_HEADER_H
 
+static int RESAMPLE_FRAMES = MAX_ALPHA * WINDOW_SIZE; //most frames in or out of one resampler call
+
 class Stretcher {
   public:
     virtual int getAvailable() = 0;
     virtual int getRequired() = 0;
-    virtual int getTimeRatio() = 0;
+    virtual double getTimeRatio() = 0;
     virtual void setTimeRatio(double ratio) = 0;
     virtual void setPitchRatio(double ratio) = 0;
     virtual void reset() = 0;
@@ -26,7 +29,7 @@ class REStretcher: public Stretcher{
     ~REStretcher();
     int getAvailable();
     int getRequired();
-    int getTimeRatio();
+    double getTimeRatio();
     void setTimeRatio(double ratio);
     void setPitchRatio(double ratio);
     void reset();
@@ -46,7 +49,7 @@ class PVStretcher: public Stretcher{
     ~PVStretcher();
     int getAvailable();
     int getRequired();
-    int getTimeRatio();
+    double getTimeRatio();
     void setTimeRatio(double ratio);
     void setPitchRatio(double ratio);
     void reset();
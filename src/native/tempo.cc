@@ -0,0 +1,157 @@
+#include "tempo.h"
+
+std::vector<float> tempo_onsets(const void* source, int format, int sourceLen){
+  int size = TEMPO_WINDOW;
+  int bins = size / 2 + 1;
+  int frames = sourceLen / TEMPO_HOP;
+  std::vector<float> flux(std::max(frames, 0), 0);
+  if(frames <= 0) return flux;
+
+  fftw_plan batchPlan = spectrum_plan(size, TEMPO_BATCH);
+  const double* window = spectrum_window(size);
+  int blockLen = size + (TEMPO_BATCH - 1) * TEMPO_HOP;
+  float* block = new float[blockLen];
+  double* in = fftw_alloc_real(size * TEMPO_BATCH);
+  fftw_complex* out = fftw_alloc_complex(bins * TEMPO_BATCH);
+  float* lastMags = new float[bins]();
+  float* mags = new float[bins];
+
+  for(int frame=0;frame<frames;frame+=TEMPO_BATCH){
+    int count = std::min(TEMPO_BATCH, frames - frame);
+    /* frames are centered on frame * hop */
+    samples_read(source, format, sourceLen, frame * TEMPO_HOP - size / 2, blockLen, block);
+    for(int f=0;f<TEMPO_BATCH;f++){
+      double* frameIn = in + f * size;
+      float* frameBlock = block + f * TEMPO_HOP;
+      for(int i=0;i<size;i++) frameIn[i] = f < count ? frameBlock[i] * window[i] : 0;
+    }
+    fftw_execute_dft_r2c(batchPlan, in, out);
+
+    for(int f=0;f<count;f++){
+      fftw_complex* frameOut = out + f * bins;
+      float frameFlux = 0;
+      for(int bin=1;bin<bins;bin++){
+        mags[bin] = log1p(1000 * sqrt(frameOut[bin][0] * frameOut[bin][0] + frameOut[bin][1] * frameOut[bin][1]) / size);
+        frameFlux += std::max(mags[bin] - lastMags[bin], 0.f);
+      }
+      std::swap(mags, lastMags);
+      flux[frame + f] = frameFlux;
+    }
+  }
+
+  /* remove the local mean so sustained loudness doesn't count as onsets */
+  std::vector<float> onsets(frames, 0);
+  double sum = 0;
+  for(int frame=0;frame<frames;frame++){
+    sum += flux[frame];
+    if(frame >= TEMPO_AVGLEN) sum -= flux[frame - TEMPO_AVGLEN];
+    float mean = sum / std::min(frame + 1, TEMPO_AVGLEN);
+    onsets[frame] = std::max(flux[frame] - mean, 0.f);
+  }
+
+  delete [] block;
+  delete [] lastMags;
+  delete [] mags;
+  fftw_free(in);
+  fftw_free(out);
+  return onsets;
+}
+
+/* autocorrelation of values up to maxLag through a zero padded fft */
+std::vector<double> tempo_autocorrelate(const std::vector<float>& values, int maxLag){
+  int length = values.size();
+  int size = 1;
+  while(size < length + maxLag) size *= 2;
+  int bins = size / 2 + 1;
+
+  double* buffer = fftw_alloc_real(size);
+  fftw_complex* spectrum = fftw_alloc_complex(bins);
+  fftw_plan forward = spectrum_plan_r2c(size, buffer, spectrum);
+  fftw_plan inverse = spectrum_plan_c2r(size, spectrum, buffer);
+
+  for(int i=0;i<size;i++) buffer[i] = i < length ? values[i] : 0;
+  fftw_execute(forward);
+  for(int bin=0;bin<bins;bin++){
+    spectrum[bin][0] = spectrum[bin][0] * spectrum[bin][0] + spectrum[bin][1] * spectrum[bin][1];
+    spectrum[bin][1] = 0;
+  }
+  fftw_execute(inverse);
+
+  std::vector<double> correlation(maxLag + 1);
+  for(int lag=0;lag<=maxLag;lag++) correlation[lag] = buffer[lag] / size;
+
+  spectrum_destroy_plan(forward);
+  spectrum_destroy_plan(inverse);
+  fftw_free(buffer);
+  fftw_free(spectrum);
+  return correlation;
+}
+
+/* onset strength at fractional frame position, linear interpolated */
+float tempo_sample(const std::vector<float>& onsets, double position){
+  int index = floor(position);
+  if(index < 0 || index + 1 >= (int)onsets.size()) return 0;
+  double fraction = position - index;
+  return onsets[index] * (1 - fraction) + onsets[index + 1] * fraction;
+}
+
+tempoEstimate tempoDetect(const void* source, int format, int sourceLen){
+  tempoEstimate estimate = {0, 0, 0, 0};
+  std::vector<float> onsets = tempo_onsets(source, format, sourceLen);
+  double fps = (double)SAMPLE_RATE / TEMPO_HOP;
+  int minLag = floor(60 * fps / TEMPO_MAX);
+  int maxLag = ceil(60 * fps / TEMPO_MIN);
+  if((int)onsets.size() < maxLag * 4) return estimate;
+
+  /* score each lag with its first harmonics, weighted by a log tempo prior */
+  std::vector<double> correlation = tempo_autocorrelate(onsets, maxLag * 3);
+  if(correlation[0] <= 0) return estimate;
+  std::vector<double> scores(maxLag + 2, 0);
+  int bestLag = minLag;
+  for(int lag=minLag;lag<=maxLag;lag++){
+    double octaves = log2((60 * fps / lag) / TEMPO_CENTER) / TEMPO_SPREAD;
+    double prior = exp(-0.5 * octaves * octaves);
+    scores[lag] = (correlation[lag] + 0.5 * correlation[lag * 2] + 0.25 * correlation[lag * 3]) * prior;
+    if(scores[lag] > scores[bestLag]) bestLag = lag;
+  }
+
+  /* parabolic peak for a fractional period */
+  double period = bestLag;
+  if(bestLag > minLag && bestLag < maxLag){
+    double left = scores[bestLag - 1];
+    double center = scores[bestLag];
+    double right = scores[bestLag + 1];
+    double curve = left - 2 * center + right;
+    if(curve < 0) period += 0.5 * (left - right) / curve;
+  }
+
+  /* small period errors add up over a track, so fit the period and phase together.
+    the grid is whichever one collects the most onset strength */
+  double bestPeriod = period;
+  double bestPhase = 0;
+  double bestPhaseScore = -1;
+  double phaseScoreSum = 0;
+  int phaseSteps = ceil(period * TEMPO_PHASE_RES);
+  for(int periodStep=-TEMPO_PERIOD_STEPS;periodStep<=TEMPO_PERIOD_STEPS;periodStep++){
+    double gridPeriod = period * (1 + TEMPO_PERIOD_RANGE * periodStep / TEMPO_PERIOD_STEPS);
+    for(int step=0;step<phaseSteps;step++){
+      double phase = step * gridPeriod / phaseSteps;
+      double phaseScore = 0;
+      for(double position=phase;position<onsets.size();position+=gridPeriod)
+        phaseScore += tempo_sample(onsets, position);
+      if(periodStep == 0) phaseScoreSum += phaseScore;
+      if(phaseScore > bestPhaseScore){
+        bestPhaseScore = phaseScore;
+        bestPhase = phase;
+        bestPeriod = gridPeriod;
+      }
+    }
+  }
+  period = bestPeriod;
+
+  estimate.bpm = 60 * fps / period;
+  estimate.period = period * TEMPO_HOP;
+  estimate.offset = bestPhase * TEMPO_HOP;
+  if(bestPhaseScore > 0) estimate.confidence = 1 - (phaseScoreSum / phaseSteps) / bestPhaseScore;
+  return estimate;
+}
@@ -0,0 +1,36 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "constants.h"
+#include "samples.h"
+#include "spectrum.h"
+
+#ifndef TEMPO_HEADER_H
+#define TEMPO_HEADER_H
+
+static int TEMPO_WINDOW = 2048; //stft size for the onset envelope
+static int TEMPO_HOP = 512;
+static int TEMPO_BATCH = 32; //frames per fftw call
+static int TEMPO_AVGLEN = 16; //frames in the local mean removed from the flux
+static double TEMPO_MIN = 70; //bpm search range
+static double TEMPO_MAX = 180;
+static double TEMPO_CENTER = 120; //bpm the prior favours, octave errors lean here
+static double TEMPO_SPREAD = 1; //prior width in octaves
+static double TEMPO_PERIOD_RANGE = 0.02; //grid fit searches the period within this fraction
+static int TEMPO_PERIOD_STEPS = 40; //each side
+static int TEMPO_PHASE_RES = 2; //phase steps per frame
+
+typedef struct{
+  double bpm;
+  double period; //samples per beat
+  double offset; //sample of the first grid beat
+  float confidence; //0-1, how much the grid stands out from other phases
+} tempoEstimate;
+
+/* onset strength per TEMPO_HOP frame from log magnitude spectral flux */
+std::vector<float> tempo_onsets(const void* source, int format, int sourceLen);
+
+tempoEstimate tempoDetect(const void* source, int format, int sourceLen);
+
+#endif
@@ -125,10 +125,63 @@ const tests = {
     audio.getWaveform("mysource", -2000, 200, dest);
     console.log(dest);
   },
+  batch: async () => {
+    audio.init("./");
+    audio.setPoolSize(2);
+    const items = _.keys(sources).map((name, i) => ({
+      path: sources[name],
+      sourceId: name,
+      priority: name === "stem" ? 1 : 0,
+    }));
+    const done = audio.loadSources(items, (sourceId, loadedIds, cancelled) =>
+      console.log("loaded", sourceId, loadedIds, cancelled)
+    );
+    audio.cancelLoads(["broken"]);
+    await done;
+    console.log("batch done");
+  },
+  dedup: async () => {
+    audio.init("./");
+    console.time("first");
+    await audio.loadSource(source, "first");
+    console.timeEnd("first");
+    console.time("shared");
+    console.log(await audio.loadSource(source, "second"));
+    console.timeEnd("shared");
+    audio.removeSource("first");
+  },
   imp: async () => {
     audio.init("./");
     await audio.loadSource(source, "mysource");
-    console.log(audio.getImpulses("mysource"));
+    console.time("impulses");
+    console.log(await audio.getImpulses("mysource"));
+    console.timeEnd("impulses");
+  },
+  tempo: async () => {
+    audio.init("./");
+    await audio.loadSource(source, "mysource");
+    console.time("tempo");
+    console.log(await audio.getTempo(["mysource"]));
+    console.timeEnd("tempo");
+  },
+  separate: async () => {
+    /* node test.js separate short center, runs without the model */
+    audio.init("./", "/tmp", process.argv[4] || "model");
+    await audio.loadSource(source, "mysource");
+    console.log("cache", audio.getSeparationCache("mysource"));
+    console.time("separate");
+    console.log(
+      await audio.separateSource("mysource", {
+        from: 44100 * 60,
+        onProgress: (done, to) => console.log("separated", done, "to", to),
+      })
+    );
+    console.timeEnd("separate");
+    console.log(await audio.getAnalysis("mysource_vocal"));
+    /* second time round comes straight from the cache */
+    console.time("cached");
+    console.log(await audio.separateSource("mysource"));
+    console.timeEnd("cached");
   },
   next: async () => {
     audio.init("./");
@@ -244,11 +297,80 @@ const tests = {
       def = !def;
     }, 1000);
   },
+  automate: async () => {
+    audio.init("./");
+    await audio.loadSource(source, "mysource");
+
+    audio.setMixTrack("mytrack", {
+      playback: {
+        chunks: [0, ssize, ssize, ssize],
+        playing: true,
+        sourceTracksParams: {
+          mysource: {
+            volume: 1,
+            offset: 0,
+          },
+        },
+      },
+      nextPlayback: null,
+    });
+
+    audio.updatePlayback({
+      period: ssize,
+      volume: 0.5,
+      playing: true,
+    });
+
+    audio.start(audio.getDefaultOutput(), true);
+
+    /* fade out over the second bar, sweep the filter down, stop on the fourth downbeat */
+    const points = [
+      [0, 1, 1, 1, 0],
+      [0, 2, 1, 0.2, 1],
+      [1, 3, 1, 0.1, 1],
+      [3, 4, 1, 0, 0],
+    ];
+    console.log("queued", audio.automate("mytrack", new Float64Array(_.flatten(points))));
+  },
+  freeze: async () => {
+    audio.init("./");
+    await audio.loadSource(source, "mysource");
+
+    audio.setMixTrack("mytrack", {
+      playback: {
+        chunks: [0, ssize, ssize, ssize],
+        playing: true,
+        alpha: 0.8,
+        filter: 0.3,
+        sourceTracksParams: {
+          mysource: {
+            volume: 1,
+            offset: 0,
+          },
+        },
+      },
+      nextPlayback: null,
+    });
+
+    audio.updatePlayback({
+      period: ssize,
+      volume: 0.5,
+      playing: true,
+    });
+
+    audio.start(audio.getDefaultOutput(), true);
+
+    await new Promise((r) => setTimeout(r, 2000));
+    console.log("frozen to", await audio.freezeMixTrack("mytrack", 4));
+    await new Promise((r) => setTimeout(r, 8000));
+    console.log("unfrozen", audio.unfreezeMixTrack("mytrack"));
+  },
 };
 
 const test = tests[process.argv[2] || "default"];
 if (!test) console.log("UNKNOWN TEST:", process.argv[2]);
 else {
   test();
+  audio.onEvents((events) => console.log("events", events));
   setInterval(() => console.log(audio.getTiming()), 1000);
 }
@@ -0,0 +1,93 @@
+#include "timing.h"
+
+typedef struct timingSnapshot {
+  double* values;
+  int tracks;
+} timingSnapshot;
+
+static timingSnapshot* timing_snapshot_new(int tracks){
+  timingSnapshot* snapshot = new timingSnapshot;
+  snapshot->values = new double[TIMING_HEADER + tracks * TIMING_TRACK_FIELDS]();
+  snapshot->tracks = tracks;
+  return snapshot;
+}
+
+/* js may still hold an ArrayBuffer over an outgrown snapshot, so none are ever freed */
+static std::atomic<timingSnapshot*> latest(timing_snapshot_new(TIMING_TRACKS));
+static timingSnapshot* writing = NULL; //audio thread's
+static std::vector<bool> slotsUsed;
+static std::atomic<int> slotsVersion(0);
+
+/* the counter shares the first double, js reads it through an Int32Array with Atomics.load */
+static std::atomic<uint32_t>* timing_seq(timingSnapshot* snapshot){
+  return reinterpret_cast<std::atomic<uint32_t>*>(snapshot->values);
+}
+
+double* timing_buffer(){
+  return latest.load()->values;
+}
+
+size_t timing_size(){
+  return (TIMING_HEADER + latest.load()->tracks * TIMING_TRACK_FIELDS) * sizeof(double);
+}
+
+int timing_slot_new(){
+  int slot = 0;
+  while(slot < (int)slotsUsed.size() && slotsUsed[slot]) slot++;
+  if(slot == (int)slotsUsed.size()) slotsUsed.push_back(false);
+  slotsUsed[slot] = true;
+  slotsVersion++;
+
+  /* out of room, double the snapshot. the version is bumped first so the audio thread leaves it 
+  in the old one when it switches over, which is how js knows to fetch the new buffer */
+  timingSnapshot* current = latest.load();
+  if(slot >= current->tracks){
+    timingSnapshot* grown = timing_snapshot_new(current->tracks * 2);
+    memcpy(grown->values, current->values, (TIMING_HEADER + current->tracks * TIMING_TRACK_FIELDS) * sizeof(double));
+    grown->values[TIMING_SEQ] = 0;
+    grown->values[TIMING_SLOTS_VERSION] = slotsVersion.load();
+    latest.store(grown, std::memory_order_release);
+  }
+  return slot;
+}
+
+void timing_slot_free(int slot){
+  if(slot < 0) return;
+  slotsUsed[slot] = false;
+  slotsVersion++;
+}
+
+static void timing_seq_bump(std::memory_order order){
+  std::atomic<uint32_t>* seq = timing_seq(writing);
+  seq->store(seq->load(std::memory_order_relaxed) + 1, order);
+}
+
+void timing_begin(){
+  timingSnapshot* next = latest.load(std::memory_order_acquire);
+  if(writing != next){
+    /* last write to the outgrown snapshot, the changed version sends js to the new one */
+    if(writing != NULL){
+      timing_seq_bump(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      writing->values[TIMING_SLOTS_VERSION] = slotsVersion.load(std::memory_order_relaxed);
+      timing_seq_bump(std::memory_order_release);
+    }
+    writing = next;
+  }
+  timing_seq_bump(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void timing_set(int field, double value){
+  writing->values[field] = value;
+}
+
+void timing_set_track(int slot, int field, double value){
+  if(slot >= writing->tracks) return; //taken after the snapshot grew, published from the next buffer on
+  writing->values[TIMING_HEADER + slot * TIMING_TRACK_FIELDS + field] = value;
+}
+
+void timing_end(){
+  writing->values[TIMING_SLOTS_VERSION] = slotsVersion.load(std::memory_order_relaxed);
+  timing_seq_bump(std::memory_order_release);
+}
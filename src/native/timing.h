@@ -0,0 +1,54 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifndef TIMING_HEADER_H
+#define TIMING_HEADER_H
+
+/* the engine's timing published for js to read without calling in. doubles throughout, the first
+four bytes double as a seqlock counter that's odd while the audio thread is writing */
+static const int TIMING_TRACKS = 64; //slots to start with, the snapshot doubles when they run out
+static const int TIMING_HEADER = 8; //doubles before the first slot
+static const int TIMING_TRACK_FIELDS = 8; //doubles per slot
+
+enum timingField {
+  TIMING_SEQ, //uint32 in the low bytes
+  TIMING_TIME,
+  TIMING_REC_TIME,
+  TIMING_MAX_LEVEL,
+  TIMING_SLOTS_VERSION, //changes when tracks take or give up slots
+  TIMING_FRAME //output frames since the engine started, what automation is timed against
+};
+
+enum timingTrackField {
+  TIMING_TRACK_SAMPLE,
+  TIMING_TRACK_CHUNK_INDEX,
+  TIMING_TRACK_PLAYING,
+  TIMING_TRACK_HAS_NEXT,
+  TIMING_TRACK_NEXT_CHUNK_INDEX,
+  TIMING_TRACK_NEXT_PLAYING,
+  TIMING_TRACK_LEVEL
+};
+
+/* the latest snapshot memory, lives as long as the process. a newer one replaces it when slots
+run out, js fetches it again when it sees the slots version change */
+double* timing_buffer();
+
+size_t timing_size();
+
+/* take a free slot for a track, growing the snapshot if needed. js thread only */
+int timing_slot_new();
+
+void timing_slot_free(int slot);
+
+/* audio thread only, between begin and end the snapshot is being written */
+void timing_begin();
+
+void timing_set(int field, double value);
+
+void timing_set_track(int slot, int field, double value);
+
+void timing_end();
+
+#endif
@@ -4,7 +4,8 @@
 void minMaxWaveform(
   float scale,
   int start,
-  float* source,
+  const void* source,
+  int format,
   int sourceLen,
   float* dest, 
   int destLen,
@@ -27,7 +28,7 @@ void minMaxWaveform(
     max = 0;
     for(sample=fstart;sample<fend;sample+=skip){
       if(sample > 0 && sample < sourceLen){
-        sampleVal = source[sample] * vscale;
+        sampleVal = samples_get(source, format, sample) * vscale;
         if(sampleVal > 0 && sampleVal > max) max = sampleVal;
         if(sampleVal < 0 && sampleVal < min) min = sampleVal;
       }
@@ -41,4 +42,230 @@ void minMaxWaveform(
     }
     
   }
+}
+
+pyramidLevel pyramid_level(int length){
+  pyramidLevel level;
+  level.length = length;
+  level.capacity = length;
+  level.min = new float[length]();
+  level.max = new float[length]();
+  level.power = new float[length]();
+  return level;
+}
+
+void pyramid_grow(float*& values, int length, int capacity){
+  float* grown = new float[capacity]();
+  std::copy(values, values + length, grown);
+  delete [] values;
+  values = grown;
+}
+
+void pyramid_resize(waveformPyramid* pyramid, int bins){
+  int length = std::max(bins, 1);
+  for(unsigned int levelIndex=0;;levelIndex++){
+    if(levelIndex == pyramid->levels.size()) pyramid->levels.push_back(pyramid_level(length));
+    pyramidLevel& level = pyramid->levels[levelIndex];
+    if(level.capacity < length){
+      int capacity = std::max(length, level.capacity * 2);
+      pyramid_grow(level.min, level.length, capacity);
+      pyramid_grow(level.max, level.length, capacity);
+      pyramid_grow(level.power, level.length, capacity);
+      level.capacity = capacity;
+    }
+    level.length = length;
+    if(length <= 1) break;
+    length = (length + 1) / 2;
+  }
+}
+
+waveformPyramid* pyramid_new(int sourceLen){
+  waveformPyramid* pyramid = new waveformPyramid{};
+  pyramid->base = PYRAMID_BASE;
+  pyramid_resize(pyramid, (sourceLen + PYRAMID_BASE - 1) / PYRAMID_BASE);
+  return pyramid;
+}
+
+/* fill bins [from, to) of the finest level from float samples starting at bin from */
+void pyramid_fill(waveformPyramid* pyramid, const float* samples, int from, int to){
+  pyramidLevel& level = pyramid->levels[0];
+  for(int bin=from;bin<to;bin++){
+    const float* binSamples = samples + (bin - from) * pyramid->base;
+    float min = 0;
+    float max = 0;
+    float power = 0;
+    for(int i=0;i<pyramid->base;i++){
+      min = std::min(min, binSamples[i]);
+      max = std::max(max, binSamples[i]);
+      power += binSamples[i] * binSamples[i];
+    }
+    level.min[bin] = min;
+    level.max[bin] = max;
+    level.power[bin] = power;
+  }
+}
+
+/* rebuild the coarser levels covering finest level bins [from, to) */
+void pyramid_reduce(waveformPyramid* pyramid, int from, int to){
+  for(unsigned int levelIndex=1;levelIndex<pyramid->levels.size();levelIndex++){
+    pyramidLevel& level = pyramid->levels[levelIndex];
+    pyramidLevel& child = pyramid->levels[levelIndex-1];
+    from /= 2;
+    to = std::min((to + 1) / 2, level.length);
+    for(int bin=from;bin<to;bin++){
+      int left = bin * 2;
+      int right = std::min(left + 1, child.length - 1);
+      level.min[bin] = std::min(child.min[left], child.min[right]);
+      level.max[bin] = std::max(child.max[left], child.max[right]);
+      level.power[bin] = child.power[left] + (right != left ? child.power[right] : 0);
+    }
+  }
+}
+
+void pyramid_delete(waveformPyramid* pyramid){
+  for(unsigned int i=0;i<pyramid->levels.size();i++){
+    delete [] pyramid->levels[i].min;
+    delete [] pyramid->levels[i].max;
+    delete [] pyramid->levels[i].power;
+  }
+  delete pyramid;
+}
+
+/* min/max/power over samples [from, to), raw samples at the unaligned edges and
+  the fewest bins possible in between */
+template <typename Reader>
+void pyramid_range(
+  waveformPyramid* pyramid,
+  Reader read,
+  int from,
+  int to,
+  float& min,
+  float& max,
+  double& power
+){
+  int base = pyramid->base;
+  float sampleVal;
+  while(from < to && from % base){
+    sampleVal = read(from++);
+    min = std::min(min, sampleVal);
+    max = std::max(max, sampleVal);
+    power += sampleVal * sampleVal;
+  }
+  while(to > from && to % base){
+    sampleVal = read(--to);
+    min = std::min(min, sampleVal);
+    max = std::max(max, sampleVal);
+    power += sampleVal * sampleVal;
+  }
+
+  int startBin = from / base;
+  int endBin = to / base;
+  for(unsigned int levelIndex=0;startBin<endBin && levelIndex<pyramid->levels.size();levelIndex++){
+    pyramidLevel& level = pyramid->levels[levelIndex];
+    if(startBin & 1){
+      min = std::min(min, level.min[startBin]);
+      max = std::max(max, level.max[startBin]);
+      power += level.power[startBin];
+      startBin++;
+    }
+    if(endBin & 1){
+      endBin--;
+      min = std::min(min, level.min[endBin]);
+      max = std::max(max, level.max[endBin]);
+      power += level.power[endBin];
+    }
+    startBin /= 2;
+    endBin /= 2;
+  }
+}
+
+template <typename Reader>
+void pyramid_waveform(
+  waveformPyramid* pyramid,
+  Reader read,
+  float scale,
+  int start,
+  int sourceLen,
+  float* dest, 
+  int destLen,
+  float* rmsDest,
+  bool add,
+  float vscale
+){
+  int width = destLen / 2;
+  int base = pyramid->base;
+
+  /* zoomed out, snap pixel edges to bins. neighbours share edges so no sample is missed */
+  bool snap = scale >= base * PYRAMID_SNAP;
+
+  int fstart;
+  int fend;
+  float min;
+  float max;
+  double power;
+  for(int i=0;i<width;i++){
+    fstart = floor(i*scale + start);
+    fend = floor((i+1)*scale + start);
+    if(snap){
+      fstart = round(fstart / (float)base) * base;
+      fend = round(fend / (float)base) * base;
+    }
+    fstart = std::max(fstart, 0);
+    fend = std::min(fend, sourceLen);
+    min = 0;
+    max = 0;
+    power = 0;
+    if(fstart < fend) pyramid_range(pyramid, read, fstart, fend, min, max, power);
+
+    min *= vscale;
+    max *= vscale;
+    float rms = fstart < fend ? sqrt(power / (fend - fstart)) * vscale : 0;
+    if(add){
+      dest[i*2] += min;
+      dest[i*2 + 1] += max;
+      if(rmsDest) rmsDest[i] += rms;
+    }else{
+      dest[i*2] = min;
+      dest[i*2 + 1] = max;
+      if(rmsDest) rmsDest[i] = rms;
+    }
+  }
+}
+
+void pyramidWaveform(
+  waveformPyramid* pyramid,
+  float scale,
+  int start,
+  const void* source,
+  int format,
+  int sourceLen,
+  float* dest, 
+  int destLen,
+  float* rmsDest,
+  bool add,
+  float vscale
+){
+  pyramid_waveform(
+    pyramid, [source, format](int index){ return samples_get(source, format, index); },
+    scale, start, sourceLen, dest, destLen, rmsDest, add, vscale
+  );
+}
+
+void chunkedPyramidWaveform(
+  waveformPyramid* pyramid,
+  float scale,
+  int start,
+  const std::vector<float*>& chunks,
+  int chunkSize,
+  int sourceLen,
+  float* dest, 
+  int destLen,
+  float* rmsDest,
+  bool add,
+  float vscale
+){
+  pyramid_waveform(
+    pyramid, [&chunks, chunkSize](int index){ return chunks[index / chunkSize][index % chunkSize]; },
+    scale, start, sourceLen, dest, destLen, rmsDest, add, vscale
+  );
 }
\ No newline at end of file
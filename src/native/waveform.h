@@ -1,10 +1,80 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "samples.h"
+
+#ifndef WAVEFORM_HEADER_H
+#define WAVEFORM_HEADER_H
+
+static int PYRAMID_BASE = 128; //samples per bin on the finest level
+static int PYRAMID_SNAP = 8; //bins per pixel before pixel edges snap to bins
+
+typedef struct{
+  float* min;
+  float* max;
+  float* power; //sum of squares
+  int length;
+  int capacity;
+} pyramidLevel;
+
+/* min/max/power mipmap, each level halves the one below */
+typedef struct{
+  std::vector<pyramidLevel> levels;
+  int base;
+} waveformPyramid;
+
+waveformPyramid* pyramid_new(int sourceLen);
+
+/* set the number of finest level bins, growing levels as needed. existing bins are kept */
+void pyramid_resize(waveformPyramid* pyramid, int bins);
+
+void pyramid_fill(waveformPyramid* pyramid, const float* samples, int from, int to);
+
+void pyramid_reduce(waveformPyramid* pyramid, int from, int to);
+
+void pyramid_delete(waveformPyramid* pyramid);
+
 void minMaxWaveform(
   float scale,
   int start,
-  float* source,
+  const void* source,
+  int format,
   int sourceLen,
   float* dest, 
   int destLen,
   bool add,
   float vscale
-);
\ No newline at end of file
+);
+
+/* same output as minMaxWaveform but exact and O(pixels), rmsDest is optional and destLen/2 long */
+void pyramidWaveform(
+  waveformPyramid* pyramid,
+  float scale,
+  int start,
+  const void* source,
+  int format,
+  int sourceLen,
+  float* dest, 
+  int destLen,
+  float* rmsDest,
+  bool add,
+  float vscale
+);
+
+/* pyramidWaveform over float channel data split into equal sized chunks */
+void chunkedPyramidWaveform(
+  waveformPyramid* pyramid,
+  float scale,
+  int start,
+  const std::vector<float*>& chunks,
+  int chunkSize,
+  int sourceLen,
+  float* dest, 
+  int destLen,
+  float* rmsDest,
+  bool add,
+  float vscale
+);
+
+#endif
\ No newline at end of file
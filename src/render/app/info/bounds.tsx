@@ -5,6 +5,7 @@ import { useDispatch, useSelector } from 'render/redux/react'
 import * as Actions from 'render/redux/actions'
 
 import { RATE } from 'render/util/audio'
+import inferBounds from 'render/util/infer-bounds'
 
 import Icon from 'render/components/icon'
 import {
@@ -42,19 +43,15 @@ const BoundsControl = memo((props: BoundsControlProps) => {
     snap = useSelector((state) => state.settings.snap),
     hasTimeBase = !!bounds.length,
     clength = playback.chunks[1],
-    inferPayload = useMemo(() => (sourceId === null ? null : { sourceId }), [sourceId]),
     inferLR = useCallback(() => {
-      inferPayload &&
-        dispatch(Actions.inferBounds({ ...inferPayload, direction: 'both' }))
-    }, [inferPayload]),
+      sourceId !== null && inferBounds(sourceId, 'both', dispatch)
+    }, [sourceId]),
     inferLeft = useCallback(() => {
-      inferPayload &&
-        dispatch(Actions.inferBounds({ ...inferPayload, direction: 'left' }))
-    }, [inferPayload]),
+      sourceId !== null && inferBounds(sourceId, 'left', dispatch)
+    }, [sourceId]),
     inferRight = useCallback(() => {
-      inferPayload &&
-        dispatch(Actions.inferBounds({ ...inferPayload, direction: 'right' }))
-    }, [inferPayload]),
+      sourceId !== null && inferBounds(sourceId, 'right', dispatch)
+    }, [sourceId]),
     avgBar = useMemo(() => {
       let sum = 0
       bounds.forEach((bound, i) => {
@@ -21,10 +21,12 @@ const Separate = memo((props: SeparateProps) => {
       ) ?? '??',
     dispatch = useDispatch(),
     [loading, setLoading] = useState(false),
+    [progress, setProgress] = useState(0),
     handleSeparate = useCallback(async () => {
       if (!props.sourceId) return
       setLoading(true)
-      await separate(name, props.sourceId, dispatch)
+      setProgress(0)
+      await separate(name, props.sourceId, dispatch, setProgress)
       setLoading(false)
     }, [props.sourceId, name])
 
@@ -42,7 +44,7 @@ const Separate = memo((props: SeparateProps) => {
             ) : (
               <>
                 <Spinner />
-                &nbsp;Separating...
+                &nbsp;Separating... {Math.floor(progress * 100)}%
               </>
             )}
           </FillButton>
@@ -1,10 +1,10 @@
-import { useEffect, useMemo, useContext, useRef } from 'react'
+import { useEffect, useMemo, useContext, useRef, useState } from 'react'
 import { CtyledContext, Color } from 'ctyled'
 import * as _ from 'lodash'
 
 import * as Types from 'render/util/types'
 import { findNearest } from 'render/util/impulse-detect'
-import audio from 'render/util/audio'
+import requestWaveform, { createWaveformBuffer } from 'render/util/waveforms'
 import { DrawViewContext } from './track'
 import { canvasScale } from 'render/util/env'
 
@@ -62,23 +62,38 @@ export default function useWaveformCanvas(
 
   const bufferRes = pwidth,
     drawBuffers = useMemo(
-      () => [new Float32Array(bufferRes * 2), new Float32Array(bufferRes * 2)],
+      () => [createWaveformBuffer(bufferRes * 2), createWaveformBuffer(bufferRes * 2)],
       [width]
-    )
+    ),
+    [filled, setFilled] = useState(0)
 
-  /* main waveform compute */
+  /* main waveform compute, filled off thread then redrawn */
   useEffect(() => {
-    if (visibleLoaded && width && visId)
-      audio.getWaveform(visId, start - (visibleOffset ?? 0), scale, drawBuffers[0])
+    if (visibleLoaded && width && visId) {
+      let current = true
+      requestWaveform({
+        sourceId: visId,
+        start: start - (visibleOffset ?? 0),
+        scale,
+        dest: drawBuffers[0],
+      }).then(() => current && setFilled((f) => f + 1))
+      return () => {
+        current = false
+      }
+    }
   }, [drawBuffers, track.visibleSourceTrack, start, scale, visibleLoaded])
   useEffect(() => {
     if (editTrackLoaded && width && track.sourceTrackEditing) {
-      return audio.getWaveform(
-        track.sourceTrackEditing,
-        start - (editTrackOffset || 0),
+      let current = true
+      requestWaveform({
+        sourceId: track.sourceTrackEditing,
+        start: start - (editTrackOffset || 0),
         scale,
-        drawBuffers[1]
-      )
+        dest: drawBuffers[1],
+      }).then(() => current && setFilled((f) => f + 1))
+      return () => {
+        current = false
+      }
     }
   }, [
     drawBuffers,
@@ -142,6 +157,7 @@ export default function useWaveformCanvas(
     cues,
     ctyledContext.theme.color,
     jogging,
+    filled,
     ..._.values(view),
   ])
 
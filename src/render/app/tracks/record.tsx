@@ -99,9 +99,9 @@ const Recording = memo(
     const pwidth = pos.width * canvasScale,
       pheight = pos.height * canvasScale,
       drawBuffer = useMemo(() => new Float32Array(pwidth * 2), [pos.width]),
-      scale = 200,
-      sampleWidth = scale * pwidth,
-      start = recLength > sampleWidth ? recLength - sampleWidth : 0
+      /* the native pyramid makes the whole take cheap to draw, so zoom out as it grows */
+      scale = pwidth ? Math.max(200, recLength / pwidth) : 200,
+      start = 0
 
     const canvasRef = useRef<HTMLCanvasElement | null>(null),
       ctxt = useRef<CanvasRenderingContext2D | null | undefined>(null)
@@ -17,7 +17,8 @@ import * as Selectors from 'render/redux/selectors'
 import * as Actions from 'render/redux/actions'
 import { canvasScale } from 'render/util/env'
 
-import getImpulses from 'render/util/impulse-detect'
+import { detectImpulses } from 'render/util/impulse-detect'
+import { detectTempo } from 'render/util/tempo'
 
 import { getRelativePos, getBoundIndex, getTimeFromPosition } from './utils'
 import { useSelectable } from 'render/components/selection'
@@ -130,12 +131,22 @@ const Track = memo(
     trackScroll,
   }: TrackProps) {
     /* computed data */
-    const impulses = useMemo(() => (loaded ? getImpulses(trackId) : []), [
-        loaded,
-        trackId,
-      ]),
+    const [impulses, setImpulses] = useState<number[]>([]),
       snap = useSelector((state) => state.settings.snap)
 
+    useEffect(() => {
+      if (!loaded) {
+        setImpulses([])
+        return
+      }
+      let current = true
+      detectImpulses(trackId).then((detected) => current && setImpulses(detected))
+      detectTempo(trackId)
+      return () => {
+        current = false
+      }
+    }, [loaded, trackId])
+
     /* react state */
     const [center, setCenter] = useState(0),
       [clickX, setClickX] = useState<number | null>(null),
@@ -12,6 +12,7 @@ import * as Actions from 'render/redux/actions'
 import * as Selectors from 'render/redux/selectors'
 import { defaultState } from 'render/redux/defaults'
 import useAddSource from 'render/util/add-source'
+import inferBounds from 'render/util/infer-bounds'
 import uid from 'render/util/uid'
 
 import { useSelection } from 'render/components/selection'
@@ -169,9 +170,22 @@ export default function init() {
                   name: 'AAC Audio',
                   extensions: ['m4a'],
                 },
+                {
+                  name: 'FLAC Audio',
+                  extensions: ['flac'],
+                },
+                {
+                  name: 'WAV Audio',
+                  extensions: ['wav'],
+                },
               ],
             })
-            if (path) audio.exportSource(path, selectedTrackId)
+            if (path) {
+              const ext = pathUtils.extname(path).toLowerCase()
+              audio.exportSource(path, selectedTrackId, {
+                codec: ext === '.flac' ? 'flac' : ext === '.wav' ? 'wav' : 'aac',
+              })
+            }
           },
           accelerator: 'CmdOrCtrl+Alt+E',
         },
@@ -268,36 +282,15 @@ export default function init() {
           accelerator: 'CmdOrCtrl+E',
         },
         inferDivisions: {
-          click: () =>
-            menuState.sourceId &&
-            dispatch(
-              Actions.inferBounds({
-                sourceId: menuState.sourceId,
-                direction: 'both',
-              })
-            ),
+          click: () => menuState.sourceId && inferBounds(menuState.sourceId, 'both', dispatch),
           accelerator: '\\',
         },
         inferLeft: {
-          click: () =>
-            menuState.sourceId &&
-            dispatch(
-              Actions.inferBounds({
-                sourceId: menuState.sourceId,
-                direction: 'left',
-              })
-            ),
+          click: () => menuState.sourceId && inferBounds(menuState.sourceId, 'left', dispatch),
           accelerator: '[',
         },
         inferRight: {
-          click: () =>
-            menuState.sourceId &&
-            dispatch(
-              Actions.inferBounds({
-                sourceId: menuState.sourceId,
-                direction: 'right',
-              })
-            ),
+          click: () => menuState.sourceId && inferBounds(menuState.sourceId, 'right', dispatch),
           accelerator: ']',
         },
         clearDivisions: {
@@ -647,6 +640,15 @@ export default function init() {
         lowRate: {
           click: () => dispatch(Actions.setSettings({ updateRate: 'low' })),
         },
+        float32Format: {
+          click: () => dispatch(Actions.setSettings({ sourceFormat: 'float32' })),
+        },
+        int16Format: {
+          click: () => dispatch(Actions.setSettings({ sourceFormat: 'int16' })),
+        },
+        float16Format: {
+          click: () => dispatch(Actions.setSettings({ sourceFormat: 'float16' })),
+        },
         resetZoom: {
           click: () =>
             dispatch(
@@ -1180,6 +1182,29 @@ export default function init() {
                 },
               ],
             },
+            {
+              label: 'Sample Storage',
+              submenu: [
+                {
+                  label: 'Float 32',
+                  type: 'checkbox',
+                  checked: menuState.settings.sourceFormat === 'float32',
+                  ...menuCommands.float32Format,
+                },
+                {
+                  label: 'Int 16',
+                  type: 'checkbox',
+                  checked: menuState.settings.sourceFormat === 'int16',
+                  ...menuCommands.int16Format,
+                },
+                {
+                  label: 'Float 16',
+                  type: 'checkbox',
+                  checked: menuState.settings.sourceFormat === 'float16',
+                  ...menuCommands.float16Format,
+                },
+              ],
+            },
             {
               label: menuState.settings.libOpen ? 'Hide Library' : 'Show Library',
               ...menuCommands.library,
@@ -204,6 +204,8 @@ export const copyTrackBounds = createAction<{
 export const inferBounds = createAction<{
   sourceId: string
   direction: 'left' | 'right' | 'both'
+  impulses: number[]
+  tempo: Types.TempoEstimate | null
 }>('INFER_BOUNDS')
 
 export const setSourceAlpha = createAction<{
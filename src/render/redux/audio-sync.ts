@@ -12,7 +12,10 @@ import diff from 'render/util/diff'
 import reducer from 'render/redux/reducer'
 import isEqual from 'render/util/is-equal'
 import { updateTiming, removeTrackTimings } from 'render/components/timing'
+import readTiming from 'render/util/timing-snapshot'
+import ParamBatch from 'render/util/params'
 import { isMac } from 'render/util/env'
+import { getPath } from 'render/loading/app-paths'
 
 export const UPDATE_PERIODS = {
     high: 17,
@@ -21,6 +24,14 @@ export const UPDATE_PERIODS = {
   },
   isDev = process.env.NODE_ENV === 'development'
 
+/* selected deck loads first, then anything already playing */
+function getLoadPriority(state: Types.State, trackId: string) {
+  const track = state.live.tracks[trackId]
+  if (track.selected) return 2
+  else if (track.playback.playing) return 1
+  else return 0
+}
+
 type TrackPlaybackState = {
   playback: Types.TrackPlayback
   nextPlayback: Types.TrackPlayback
@@ -33,10 +44,12 @@ export default function syncAudio(store: Store<Types.State>) {
     } = {},
     lastTrackPlaybacks: { [trackId: string]: TrackPlaybackState } = {},
     lastGlobalPlayback: Types.Playback | null = null,
-    loadingSources: { [sourceId: string]: boolean } = {}
+    loadingSources: { [sourceId: string]: boolean } = {},
+    loadHandlers: { [sourceId: string]: (loadedIds: string[]) => void } = {},
+    params = new ParamBatch()
 
   const appPath = isDev ? './' : remote.app.getAppPath() + '/'
-  audio.init(appPath)
+  audio.init(appPath, getPath('cache'))
 
   const currentOutput = store.getState().output.current,
     availableOutputs = audio.getOutputs(),
@@ -57,15 +70,21 @@ export default function syncAudio(store: Store<Types.State>) {
       trackIds = Selectors.getActiveTrackIds(currentState),
       lastTrackIds = lastState ? Selectors.getActiveTrackIds(lastState) : [],
       playback = Selectors.getGlobalPlayback(currentState),
-      currentPath = currentState.save.path || ''
+      currentPath = currentState.save.path || '',
+      pendingLoads: Types.LoadItem[] = []
 
     if (!lastState || !isEqual(playback, lastGlobalPlayback)) {
       const change = diff(lastGlobalPlayback === null ? {} : lastGlobalPlayback, playback)
       //console.log('update playback', change)
-      audio.updatePlayback(change)
+      if (ParamBatch.covers(null, change)) params.add(null, change)
+      else audio.updatePlayback(change)
       lastGlobalPlayback = playback
     }
 
+    /* storage format for newly loaded sources */
+    if (!lastState || lastState.settings.sourceFormat !== currentState.settings.sourceFormat)
+      audio.setSourceFormat(currentState.settings.sourceFormat ?? 'float32') //missing from older saved settings
+
     trackIds.forEach((trackId) => {
       const trackIsNew = !lastState || !lastTrackIds.includes(trackId),
         sourceId = currentState.live.tracks[trackId].sourceId,
@@ -76,7 +95,7 @@ export default function syncAudio(store: Store<Types.State>) {
         current = playbackSelectors[trackId](currentState, trackId)
 
       if (source && sourceId) {
-        _.keys(current.playback.sourceTracksParams).forEach(async (sourceTrackId) => {
+        _.keys(current.playback.sourceTracksParams).forEach((sourceTrackId) => {
           const sourceTrack = source.sourceTracks[sourceTrackId],
             sourceTrackIsNew = !sourceTrack.loaded
 
@@ -95,51 +114,58 @@ export default function syncAudio(store: Store<Types.State>) {
                   ? sourcePath
                   : pathUtils.resolve(pathUtils.dirname(currentPath), sourcePath))
 
-            loadingSources[sourceTrackId] = true
-            const loadedIds =
-              sourcePath && (await audio.loadSource(absSorucePath, sourceTrackId))
-
-            if (loadedIds && loadedIds.length) {
-              const newTrackActions: Action<any>[] = []
-              loadedIds.forEach((sourceTrackId, index) => {
-                newTrackActions.push(
-                  Actions.didLoadTrackSource({
-                    sourceId,
-                    sourceTrackId: sourceTrackId,
-                    loaded: true,
-                    missing: false,
-                  })
-                )
-                if (!source.sourceTracks[sourceTrackId]) {
+            const handleLoaded = (loadedIds: string[] | null) => {
+              if (loadedIds && loadedIds.length) {
+                const newTrackActions: Action<any>[] = []
+                loadedIds.forEach((sourceTrackId, index) => {
                   newTrackActions.push(
-                    Actions.createTrackSource({
+                    Actions.didLoadTrackSource({
                       sourceId,
-                      sourceTrackId,
-                      sourceTrack: {
-                        name: index + ':' + trackName,
-                        source: sourcePath,
-                        loaded: true,
-                        missing: false,
-                        streamIndex: index, //only first source is primary
-                        base: null,
-                      },
+                      sourceTrackId: sourceTrackId,
+                      loaded: true,
+                      missing: false,
                     })
                   )
-                }
-              })
-              store.dispatch(batchActions(newTrackActions, 'LOAD_TRACK'))
-              audio.setMixTrack(trackId, current)
-            } else {
-              store.dispatch(
-                Actions.didLoadTrackSource({
-                  sourceId,
-                  sourceTrackId: sourceTrackId,
-                  loaded: false,
-                  missing: true,
+                  if (!source.sourceTracks[sourceTrackId]) {
+                    newTrackActions.push(
+                      Actions.createTrackSource({
+                        sourceId,
+                        sourceTrackId,
+                        sourceTrack: {
+                          name: index + ':' + trackName,
+                          source: sourcePath,
+                          loaded: true,
+                          missing: false,
+                          streamIndex: index, //only first source is primary
+                          base: null,
+                        },
+                      })
+                    )
+                  }
                 })
-              )
+                store.dispatch(batchActions(newTrackActions, 'LOAD_TRACK'))
+                audio.setMixTrack(trackId, current)
+              } else {
+                store.dispatch(
+                  Actions.didLoadTrackSource({
+                    sourceId,
+                    sourceTrackId: sourceTrackId,
+                    loaded: false,
+                    missing: true,
+                  })
+                )
+              }
             }
-            delete loadingSources[sourceTrackId]
+
+            if (sourcePath) {
+              loadingSources[sourceTrackId] = true
+              pendingLoads.push({
+                path: absSorucePath,
+                sourceId: sourceTrackId,
+                priority: getLoadPriority(currentState, trackId),
+              })
+              loadHandlers[sourceTrackId] = handleLoaded
+            } else Promise.resolve(null).then(handleLoaded)
           }
         })
       }
@@ -151,11 +177,21 @@ export default function syncAudio(store: Store<Types.State>) {
         trackIsLoaded = _.every(source?.sourceTracks, (st) => st.loaded)
 
       if (trackPlaybackHasChanged && trackIsLoaded) {
-        const change: Types.NativeTrackChange = {
-          playback: diff(trackIsNew ? {} : prev.playback, current.playback, ['playing']),
-          nextPlayback: current.nextPlayback,
-        }
-        audio.setMixTrack(trackId, change)
+        const playbackChange = diff(trackIsNew ? {} : prev.playback, current.playback, [
+          'playing',
+        ])
+        /* knobs and transport go in one binary batch, anything structural sends the whole change */
+        if (
+          !trackIsNew &&
+          prev.nextPlayback === current.nextPlayback &&
+          ParamBatch.covers(trackId, playbackChange)
+        )
+          params.add(trackId, playbackChange)
+        else
+          audio.setMixTrack(trackId, {
+            playback: playbackChange,
+            nextPlayback: current.nextPlayback,
+          })
       }
 
       if (!trackIsNew)
@@ -165,6 +201,14 @@ export default function syncAudio(store: Store<Types.State>) {
       lastTrackPlaybacks[trackId] = current
     })
 
+    if (pendingLoads.length)
+      audio.loadSources(pendingLoads, (sourceTrackId, loadedIds, cancelled) => {
+        const handleLoaded = loadHandlers[sourceTrackId]
+        delete loadHandlers[sourceTrackId]
+        delete loadingSources[sourceTrackId]
+        if (!cancelled && handleLoaded) handleLoaded(loadedIds)
+      })
+
     if (lastState) {
       const unloadActions: Action<any>[] = [],
         removedIds: string[] = []
@@ -179,6 +223,12 @@ export default function syncAudio(store: Store<Types.State>) {
 
           if (track && sourceId) {
             const source = currentState.sources[sourceId]
+            /* stop any loads the removed track was still waiting on */
+            const abandonedIds = _.keys(source.sourceTracks).filter(
+              (sourceTrackId) => loadingSources[sourceTrackId]
+            )
+            if (abandonedIds.length) audio.cancelLoads(abandonedIds)
+
             _.keys(source.sourceTracks).forEach((sourceTrackId) => {
               if (source.sourceTracks[sourceTrackId].loaded) {
                 audio.removeSource(sourceTrackId)
@@ -225,44 +275,44 @@ export default function syncAudio(store: Store<Types.State>) {
       }
     }
 
+    params.send()
     lastState = currentState
   }
   store.subscribe(handleUpdate)
   handleUpdate()
 
+  /* the engine says when tracks move on, so the store follows within a buffer */
+  audio.onEvents((events) => {
+    const state = store.getState()
+    if (!state.playback.playing) return
+    const needsUpdate = events.some((event) => {
+      const track = event.trackId && state.live.tracks[event.trackId]
+      if (!track) return false
+      return event.type !== 'next' || track.nextCueIndex !== -1
+    })
+    if (needsUpdate) {
+      const currentTiming = readTiming()
+      /* override last state so this change won't be sent back to where it came from */
+      lastState = reducer(state, Actions.updateTime({ timing: currentTiming, commit: false }))
+      store.dispatch(Actions.updateTime({ timing: currentTiming, commit: true }))
+    }
+  })
+
   function update() {
     let start = new Date().getTime()
-    lastState = store.getState()
-    if (lastState && lastState.playback.playing) {
-      const currentTiming = audio.getTiming()
-      let needsUpdate = _.some(lastState.live.tracks, (track, trackId) => {
-        const trackTiming = currentTiming.tracks[trackId]
-        if (!trackTiming) return false
-        const didAdvanceChunk =
-            track.playback.chunkIndex !== trackTiming.playback.chunkIndex ||
-            track.playback.playing !== track.playback.playing,
-          didAdvancePlayback = !!track.nextPlayback && !trackTiming.nextPlayback
-
-        return didAdvanceChunk || (didAdvancePlayback && track.nextCueIndex !== -1)
-      })
-      if (needsUpdate) {
-        /* override last state so this change won't be sent back to where it came from */
-        lastState = reducer(
-          lastState,
-          Actions.updateTime({ timing: currentTiming, commit: false })
-        )
-        store.dispatch(Actions.updateTime({ timing: currentTiming, commit: true }))
-      }
-      updateTiming(currentTiming)
-    }
+    const currentState = store.getState()
+    if (currentState.playback.playing) updateTiming(readTiming())
     setTimeout(
       update,
       Math.max(
-        UPDATE_PERIODS[lastState?.settings?.updateRate ?? 'medium'] -
+        UPDATE_PERIODS[currentState.settings?.updateRate ?? 'medium'] -
           (new Date().getTime() - start),
         0
       )
     )
   }
   update()
+
+  /* removed sources and tracks are freed once the engine lets go of them */
+  setInterval(() => audio.sweep(), 1000)
 }
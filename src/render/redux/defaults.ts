@@ -90,6 +90,7 @@ export const defaultPlayback: Types.Playback = {
     darkMode: true,
     size: 11,
     updateRate: 'medium',
+    sourceFormat: 'float32',
     controlsSize: 35,
     sidebarSize: 25.7,
     libSize: 20,
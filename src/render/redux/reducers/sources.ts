@@ -6,7 +6,6 @@ import * as Actions from '../actions'
 import * as Selectors from '../selectors'
 import * as Types from 'render/util/types'
 import { defaultState, defaultTrackSourceParams } from '../defaults'
-import getImpulses from 'render/util/impulse-detect'
 
 import inferTimeBase from 'render/util/infer-timebase'
 
@@ -324,11 +323,16 @@ export default createReducer(defaultState, (handle) => [
   handle(Actions.inferBounds, (state, { payload }) => {
     const track = state.live.tracks[payload.sourceId],
       [cstart, clength] = track.playback.chunks,
-      impulses = getImpulses(payload.sourceId),
+      impulses = payload.impulses,
       snap = state.settings.snap
-    if (!clength || !impulses) return state
+    if (!clength || !impulses.length) return state
     else {
-      const inferred = inferTimeBase(track.playback.chunks, impulses, snap),
+      const inferred = inferTimeBase(
+          track.playback.chunks,
+          impulses,
+          snap,
+          payload.tempo
+        ),
         existingBounds = state.sources[payload.sourceId].bounds,
         cend = cstart + clength
 
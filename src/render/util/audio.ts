@@ -5,7 +5,7 @@ import * as Types from './types'
 import { isDev } from 'render/util/env'
 
 interface AudioAPI {
-  init(root: string): void
+  init(root: string, cachePath?: string, separator?: 'model' | 'center'): void
   getOutputs(): Types.Output[]
   getDefaultOutput(): number
   start(deviceIndex: number, darwin: boolean): void
@@ -16,13 +16,56 @@ interface AudioAPI {
   updateTime(time: number, relative: boolean): void
   removeSource(sourceId: string): boolean
   setMixTrack(trackId: string, track: Types.NativeTrackChange)
+  setParams(trackIds: string[], ids: Int32Array, values: Float64Array)
+  automate(trackId: string, points: Float64Array): number
+  clearAutomation(trackId: string, param?: number)
+  freezeMixTrack(trackId: string, bars: number): Promise<string | null>
+  unfreezeMixTrack(trackId: string): boolean
   removeMixTrack(trackId: string)
   getTiming(): Types.TimingState
-  separateSource(sourceId: string): Promise<void>
-  getWaveform(sourceId: string, start: number, scale: number, dest: Float32Array)
-  getImpulses(sourceId: string): number[]
+  getTimingBuffer(): ArrayBuffer
+  getTimingSlots(): { [trackId: string]: number }
+  sweep()
+  onEvents(callback: (events: Types.EngineEvent[]) => void)
+  separateSource(
+    sourceId: string,
+    options?: {
+      from?: number
+      onProgress?: (done: number, separatedTo: number) => void
+    }
+  ): Promise<boolean>
+  cancelSeparate(sourceId: string)
+  getSeparationCache(sourceId: string): { [suffix: string]: string } | null
+  getWaveform(
+    sourceId: string,
+    start: number,
+    scale: number,
+    dest: Float32Array,
+    rmsDest?: Float32Array
+  )
+  getWaveforms(requests: Types.WaveformRequest[]): Promise<boolean>
+  getBandWaveform(sourceId: string, start: number, scale: number, dest: Float32Array)
+  getImpulses(sourceId: string): Promise<number[]>
+  getTempo(sourceIds: string[]): Promise<(Types.TempoEstimate | null)[]>
+  getAnalysis(sourceId: string): Types.SourceAnalysis | null
   loadSource(path: string, sourceId: string): Promise<string[]>
-  exportSource(path: string, sourceId: string): boolean
+  loadSources(
+    items: Types.LoadItem[],
+    onLoaded: (sourceId: string, loadedIds: string[], cancelled: boolean) => void
+  ): Promise<void>
+  cancelLoads(sourceIds?: string[])
+  setPoolSize(size: number)
+  setSourceFormat(format: Types.SourceFormat)
+  exportSource(
+    path: string,
+    sourceId: string,
+    options?: Types.ExportOptions
+  ): Promise<boolean>
+  exportSources(
+    requests: Types.ExportRequest[],
+    onProgress?: (path: string, done: number) => void
+  ): Promise<boolean[]>
+  cancelExport(path: string)
   startRecording(fromSourceId: string | null)
   stopRecording(destSourceId: string): number[]
   syncToTrack(trackId: string, start: number, end: number)
@@ -0,0 +1,27 @@
+import audio from 'render/util/audio'
+import * as Types from './types'
+
+/* mirrors automationParam in src/native/automation.h */
+const AUTOMATION_PARAMS: { [P in Types.AutomationPoint['param']]: number } = {
+  volume: 0,
+  filter: 1,
+  alpha: 2,
+  playing: 3,
+}
+
+/* schedule points on a track, false if the engine's queue couldn't take them all */
+export function automate(trackId: string, points: Types.AutomationPoint[]) {
+  const packed = new Float64Array(points.length * 5)
+  points.forEach((point, index) => {
+    packed[index * 5] = AUTOMATION_PARAMS[point.param]
+    packed[index * 5 + 1] = point.at
+    packed[index * 5 + 2] = point.phase ? 1 : 0
+    packed[index * 5 + 3] = point.value
+    packed[index * 5 + 4] = point.ramp ? 1 : 0
+  })
+  return audio.automate(trackId, packed) === points.length
+}
+
+export function clearAutomation(trackId: string, param?: Types.AutomationPoint['param']) {
+  audio.clearAutomation(trackId, param === undefined ? -1 : AUTOMATION_PARAMS[param])
+}
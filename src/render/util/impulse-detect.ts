@@ -1,13 +1,20 @@
 import audio from 'render/util/audio'
 import _ from 'lodash'
 
-const cache: { [trackId: string]: number[] } = {}
+const cache: { [trackId: string]: number[] } = {},
+  pending: { [trackId: string]: Promise<number[]> } = {}
 
-export default function (trackId: string) {
-  if (trackId && cache[trackId]) return cache[trackId]
-  const beats = audio.getImpulses(trackId).slice(1)
-  cache[trackId] = beats
-  return beats
+/* detection runs natively off thread, resolves from cache once done */
+export function detectImpulses(trackId: string): Promise<number[]> {
+  if (cache[trackId]) return Promise.resolve(cache[trackId])
+  if (!pending[trackId])
+    pending[trackId] = audio.getImpulses(trackId).then((impulses) => {
+      const beats = impulses.slice(1)
+      cache[trackId] = beats
+      delete pending[trackId]
+      return beats
+    })
+  return pending[trackId]
 }
 
 export function findNearest(impulses: number[], sample: number) {
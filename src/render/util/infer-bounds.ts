@@ -0,0 +1,15 @@
+import { Dispatch } from 'redux'
+
+import * as Actions from 'render/redux/actions'
+import { detectImpulses } from 'render/util/impulse-detect'
+import { detectTempo, confidentTempo } from 'render/util/tempo'
+
+/* detection runs natively and resolves later, so it's awaited here rather than in the reducer */
+export default async function inferBounds(
+  sourceId: string,
+  direction: 'left' | 'right' | 'both',
+  dispatch: Dispatch<any>
+) {
+  const [impulses, tempo] = await Promise.all([detectImpulses(sourceId), detectTempo(sourceId)])
+  dispatch(Actions.inferBounds({ sourceId, direction, impulses, tempo: confidentTempo(tempo) }))
+}
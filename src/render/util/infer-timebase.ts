@@ -1,28 +1,34 @@
 import snapSampleToImpulses from './snap-sample'
+import { snapToGrid } from './tempo'
 import * as Types from './types'
 
 const SNAP_SCALE = 200
 
+/* repeats the current chunk across the source, snapping each bound to the
+  beat grid when there's a confident one and to impulses otherwise */
 export default function inferTimeBase(
   chunks: Types.Chunks,
   impulses: number[],
-  snap: boolean
+  snap: boolean,
+  grid?: Types.TempoEstimate | null
 ): number[] {
   const len = impulses[impulses.length - 1], //last impulse
     bounds: number[] = [],
     cstart = chunks[0],
-    clength = chunks[1]
-  for (
-    let sample = cstart;
-    sample < len + clength;
-    sample = snapSampleToImpulses(sample + clength, SNAP_SCALE, impulses, snap)
-  ) {
+    clength = chunks[1],
+    snapSample = (sample: number) => {
+      if (!snap || !grid) return snapSampleToImpulses(sample, SNAP_SCALE, impulses, snap)
+      /* never snap further than half a chunk or short chunks could stall */
+      const snapped = snapToGrid(sample, grid)
+      return Math.abs(snapped - sample) < clength / 2 ? snapped : sample
+    }
+  for (let sample = cstart; sample < len + clength; sample = snapSample(sample + clength)) {
     bounds.push(sample)
   }
   for (
-    let sample = snapSampleToImpulses(cstart - clength, SNAP_SCALE, impulses, snap);
+    let sample = snapSample(cstart - clength);
     sample > 0 - clength;
-    sample = snapSampleToImpulses(sample - clength, SNAP_SCALE, impulses, snap)
+    sample = snapSample(sample - clength)
   ) {
     bounds.unshift(sample)
   }
@@ -0,0 +1,68 @@
+import audio from 'render/util/audio'
+
+/* mirrors the ids in src/native/params.h */
+const PARAMS_GLOBAL = -1,
+  PLAYBACK_PARAMS: { [key: string]: number } = {
+    volume: 0,
+    time: 1,
+    playing: 2,
+    period: 3,
+  },
+  TRACK_PARAMS: { [key: string]: number } = {
+    chunkIndex: 0,
+    alpha: 1,
+    volume: 2,
+    playing: 3,
+    loop: 4,
+    muted: 5,
+    filter: 6,
+    delay: 7,
+    delayGain: 8,
+    aperiodic: 9,
+    preservePitch: 10,
+    preview: 11,
+    nextAtChunk: 12,
+    unpause: 13,
+  }
+
+/* collects scalar changes so a whole update reaches the engine in one call */
+export default class ParamBatch {
+  private trackIds: string[] = []
+  private targets: { [trackId: string]: number } = {}
+  private ids: number[] = []
+  private values: number[] = []
+
+  /* whether every key in change can go in the batch */
+  static covers(trackId: string | null, change: { [key: string]: any }) {
+    const params = trackId === null ? PLAYBACK_PARAMS : TRACK_PARAMS
+    for (const key in change) if (params[key] === undefined) return false
+    return true
+  }
+
+  /* queue the keys of change that have ids, the rest are ignored */
+  add(trackId: string | null, change: { [key: string]: any }) {
+    const params = trackId === null ? PLAYBACK_PARAMS : TRACK_PARAMS
+    let target = PARAMS_GLOBAL
+    if (trackId !== null) {
+      if (this.targets[trackId] === undefined) {
+        this.targets[trackId] = this.trackIds.length
+        this.trackIds.push(trackId)
+      }
+      target = this.targets[trackId]
+    }
+    for (const key in change) {
+      if (params[key] === undefined) continue
+      this.ids.push(target, params[key])
+      this.values.push(Number(change[key]))
+    }
+  }
+
+  send() {
+    if (this.values.length)
+      audio.setParams(this.trackIds, new Int32Array(this.ids), new Float64Array(this.values))
+    this.trackIds = []
+    this.targets = {}
+    this.ids = []
+    this.values = []
+  }
+}
@@ -1,64 +1,68 @@
 import { Dispatch } from 'redux'
 import * as _ from 'lodash'
-import pathUtils from 'path'
-import fs from 'fs'
 import { batchActions } from 'redux-batched-actions'
 
 import audio from 'render/util/audio'
 import * as Actions from 'render/redux/actions'
-import { getPath } from 'render/loading/app-paths'
+
+const STEMS = [
+  { suffix: '_vocal', name: 'Vocal' },
+  { suffix: '_instru', name: 'Instru' },
+]
 
 export default async function separate(
   trackName: string,
   sourceId: string,
-  dispatch: Dispatch<any>
+  dispatch: Dispatch<any>,
+  onProgress?: (done: number) => void
 ) {
-  const cacheDir = getPath('cache'),
-    cacheDirExists = !!(await fs.promises.stat(cacheDir).catch((e) => false))
-  if (!cacheDirExists) await fs.promises.mkdir(cacheDir)
-
-  const vocalCachePath = pathUtils.join(cacheDir, trackName + '_vocal.m4a'),
-    instruCachePath = pathUtils.join(cacheDir, trackName + '_instru.m4a'),
-    cacheHit = !!(await fs.promises.stat(vocalCachePath).catch((e) => false))
-
-  if (cacheHit) {
-    await audio.loadSource(vocalCachePath, sourceId + '_vocal')
-    await audio.loadSource(instruCachePath, sourceId + '_instru')
-  } else {
-    await audio.separateSource(sourceId)
-    audio.exportSource(vocalCachePath, sourceId + '_vocal')
-    audio.exportSource(instruCachePath, sourceId + '_instru')
-  }
+  /* stems exist as soon as separation starts and fill in from the playhead, so they're usable right away.
+    content separated before is mapped straight back from the native cache */
+  const separated = audio.separateSource(sourceId, { onProgress })
 
   dispatch(
     batchActions(
-      [
-        Actions.createTrackSource({
-          sourceId,
-          sourceTrackId: sourceId + '_vocal',
-          sourceTrack: {
-            name: 'Vocal - ' + trackName,
-            source: vocalCachePath,
-            loaded: true,
-            missing: false,
-            streamIndex: 0,
-            base: null,
-          },
-        }),
+      STEMS.map(({ suffix, name }) =>
         Actions.createTrackSource({
           sourceId,
-          sourceTrackId: sourceId + '_instru',
+          sourceTrackId: sourceId + suffix,
           sourceTrack: {
-            name: 'Instru - ' + trackName,
-            source: instruCachePath,
+            name: name + ' - ' + trackName,
+            source: '',
             loaded: true,
             missing: false,
             streamIndex: 0,
             base: null,
           },
-        }),
-      ],
+        })
+      ),
       'ADD_SEPARATED_TRACKS'
     )
   )
+
+  if (!(await separated))
+    dispatch(
+      batchActions(
+        STEMS.map(({ suffix }) =>
+          Actions.removeTrackSource({ sourceId, sourceTrackId: sourceId + suffix })
+        ),
+        'REMOVE_SEPARATED_TRACKS'
+      )
+    )
+  else {
+    /* only saved with a path once its cache file is written, so a project never points at a partial one */
+    const cachePaths = audio.getSeparationCache(sourceId) ?? {}
+    dispatch(
+      batchActions(
+        STEMS.filter(({ suffix }) => cachePaths[suffix]).map(({ suffix }) =>
+          Actions.moveSourceTrack({
+            sourceId,
+            sourceTrackId: sourceId + suffix,
+            source: cachePaths[suffix],
+          })
+        ),
+        'SET_SEPARATED_PATHS'
+      )
+    )
+  }
 }
@@ -0,0 +1,46 @@
+import audio from 'render/util/audio'
+import * as Types from './types'
+
+const CONFIDENT = 0.5
+
+const cache: { [sourceId: string]: Types.TempoEstimate | null } = {},
+  pending: { [sourceId: string]: Promise<Types.TempoEstimate | null> } = {}
+
+let queued: string[] = [],
+  resolvers: { [sourceId: string]: (estimate: Types.TempoEstimate | null) => void } = {}
+
+/* sources requested in the same tick are estimated natively as one batch */
+function flush() {
+  const sourceIds = queued,
+    batchResolvers = resolvers
+  queued = []
+  resolvers = {}
+  audio.getTempo(sourceIds).then((estimates) =>
+    sourceIds.forEach((sourceId, i) => {
+      cache[sourceId] = estimates[i]
+      delete pending[sourceId]
+      batchResolvers[sourceId](estimates[i])
+    })
+  )
+}
+
+export function detectTempo(sourceId: string): Promise<Types.TempoEstimate | null> {
+  if (sourceId in cache) return Promise.resolve(cache[sourceId])
+  if (!pending[sourceId]) {
+    if (!queued.length) setTimeout(flush, 0)
+    queued.push(sourceId)
+    pending[sourceId] = new Promise((resolve) => (resolvers[sourceId] = resolve))
+  }
+  return pending[sourceId]
+}
+
+/* only estimates confident enough to build bounds on */
+export function confidentTempo(estimate: Types.TempoEstimate | null) {
+  return estimate && estimate.confidence >= CONFIDENT ? estimate : null
+}
+
+export function snapToGrid(sample: number, grid: Types.TempoEstimate) {
+  return Math.round(
+    grid.offset + Math.round((sample - grid.offset) / grid.period) * grid.period
+  )
+}
@@ -0,0 +1,79 @@
+import audio from 'render/util/audio'
+import * as Types from './types'
+
+/* mirrors the layout in src/native/timing.h */
+const TIMING_HEADER = 8,
+  TIMING_TRACK_FIELDS = 8,
+  TIMING_TIME = 1,
+  TIMING_REC_TIME = 2,
+  TIMING_MAX_LEVEL = 3,
+  TIMING_SLOTS_VERSION = 4,
+  TIMING_FRAME = 5,
+  TRACK_SAMPLE = 0,
+  TRACK_CHUNK_INDEX = 1,
+  TRACK_PLAYING = 2,
+  TRACK_HAS_NEXT = 3,
+  TRACK_NEXT_CHUNK_INDEX = 4,
+  TRACK_NEXT_PLAYING = 5,
+  TRACK_LEVEL = 6
+
+let seq: Int32Array | null = null,
+  values: Float64Array | null = null,
+  copy: Float64Array | null = null,
+  slots: { [trackId: string]: number } = {},
+  slotsVersion = -1
+
+/* consistent copy of the snapshot, retrying while the audio thread is mid write */
+function readSnapshot(): Float64Array {
+  if (!values || !seq || !copy) {
+    const buffer = audio.getTimingBuffer()
+    seq = new Int32Array(buffer, 0, 1)
+    values = new Float64Array(buffer)
+    copy = new Float64Array(values.length)
+  }
+  while (true) {
+    const before = Atomics.load(seq, 0)
+    if (before & 1) continue
+    copy.set(values)
+    if (Atomics.load(seq, 0) === before) return copy
+  }
+}
+
+/* same shape as getTiming, without calling into the engine unless tracks changed */
+export default function readTiming(): Types.TimingState {
+  let snapshot = readSnapshot()
+  if (snapshot[TIMING_SLOTS_VERSION] !== slotsVersion) {
+    /* the engine moves to a bigger buffer when it runs out of slots, so fetch that again too */
+    values = null
+    snapshot = readSnapshot()
+    slots = audio.getTimingSlots()
+    slotsVersion = snapshot[TIMING_SLOTS_VERSION]
+  }
+
+  const tracks: Types.TimingState['tracks'] = {}
+  for (const trackId in slots) {
+    const base = TIMING_HEADER + slots[trackId] * TIMING_TRACK_FIELDS,
+      playing = !!snapshot[base + TRACK_PLAYING]
+    tracks[trackId] = {
+      sample: snapshot[base + TRACK_SAMPLE],
+      level: snapshot[base + TRACK_LEVEL],
+      playback: {
+        chunkIndex: snapshot[base + TRACK_CHUNK_INDEX],
+        playing,
+      },
+      nextPlayback: snapshot[base + TRACK_HAS_NEXT]
+        ? {
+            chunkIndex: snapshot[base + TRACK_NEXT_CHUNK_INDEX],
+            playing: !!snapshot[base + TRACK_NEXT_PLAYING],
+          }
+        : null,
+    }
+  }
+  return {
+    time: snapshot[TIMING_TIME],
+    recTime: snapshot[TIMING_REC_TIME],
+    maxLevel: snapshot[TIMING_MAX_LEVEL],
+    frame: snapshot[TIMING_FRAME],
+    tracks,
+  }
+}
@@ -91,6 +91,7 @@ export interface TrackPlayback extends PersitentTrackPlayback {
 
 export interface TrackTiming extends NativeTrackChange {
   sample: number
+  level?: number
 }
 
 export interface TimingState {
@@ -98,6 +99,25 @@ export interface TimingState {
   tracks: { [trackId: string]: TrackTiming }
   recTime: number
   maxLevel: number
+  frame?: number
+}
+
+/* a scheduled change to a track param. at is an output frame like TimingState.frame, or a transport
+time like Playback time if phase is set. with ramp the value is reached at at from the point before */
+export interface AutomationPoint {
+  param: 'volume' | 'filter' | 'alpha' | 'playing'
+  at: number
+  phase?: boolean
+  value: number
+  ramp?: boolean
+}
+
+/* pushed from the audio thread, frame counts output frames since the engine started */
+export interface EngineEvent {
+  type: 'chunk' | 'next' | 'stopped' | 'phase' | 'recording'
+  trackId?: string
+  value: number
+  frame: number
 }
 
 export interface Times {
@@ -128,6 +148,34 @@ export interface NativeTrackChange {
   nextPlayback: Partial<TrackPlayback> | null
 }
 
+export interface WaveformRequest {
+  sourceId: string
+  start: number
+  scale: number
+  dest: Float32Array
+  rmsDest?: Float32Array
+  bandsDest?: Float32Array //low, mid, high per pixel
+}
+
+export interface SourceAnalysis {
+  loudness: number //integrated, LUFS
+  peak: number
+}
+
+export interface TempoEstimate {
+  bpm: number
+  period: number //samples per beat
+  offset: number //sample of the first grid beat
+  confidence: number
+}
+
+export interface LoadItem {
+  path: string
+  sourceId: string
+  priority?: number
+  format?: SourceFormat
+}
+
 export interface Track extends NativeTrack {
   sourceId: string | null
   selected: boolean
@@ -339,11 +387,28 @@ export interface SaveStatus {
 
 export type UpdateRate = 'high' | 'medium' | 'low'
 
+export type SourceFormat = 'float32' | 'int16' | 'float16'
+
+/* aac for saved files, flac and wav for caches where encode time matters */
+export type ExportCodec = 'aac' | 'flac' | 'wav'
+
+export interface ExportOptions {
+  codec?: ExportCodec
+  onProgress?: (done: number) => void
+}
+
+export interface ExportRequest {
+  sourceId: string
+  path: string
+  codec?: ExportCodec
+}
+
 export interface Settings {
   trackScroll: boolean
   darkMode: boolean
   size: number
   updateRate: UpdateRate
+  sourceFormat: SourceFormat
   controlsSize: number
   sidebarSize: number
   gridSize: number
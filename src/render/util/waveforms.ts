@@ -0,0 +1,34 @@
+import audio from 'render/util/audio'
+import * as Types from './types'
+
+/* requests made during a frame are filled natively as one batch */
+let pending: Types.WaveformRequest[] = [],
+  waiting: (() => void)[] = [],
+  scheduled = false
+
+function flush() {
+  const requests = pending,
+    resolvers = waiting
+  pending = []
+  waiting = []
+  scheduled = false
+  audio.getWaveforms(requests).then(() => resolvers.forEach((resolve) => resolve()))
+}
+
+export default function requestWaveform(request: Types.WaveformRequest): Promise<void> {
+  /* a newer request for the same buffer replaces the queued one */
+  pending = pending.filter((p) => p.dest !== request.dest)
+  pending.push(request)
+  if (!scheduled) {
+    scheduled = true
+    requestAnimationFrame(flush)
+  }
+  return new Promise((resolve) => waiting.push(resolve))
+}
+
+/* the native worker writes straight into these, shared when the renderer allows it */
+export function createWaveformBuffer(length: number) {
+  return typeof SharedArrayBuffer !== 'undefined'
+    ? new Float32Array(new SharedArrayBuffer(length * Float32Array.BYTES_PER_ELEMENT))
+    : new Float32Array(length)
+}